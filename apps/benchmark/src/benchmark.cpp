@@ -0,0 +1,361 @@
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "mdp/AsyncClient.h"
+#include "mdp/Broker.h"
+#include "mdp/LatencyHistogram.h"
+#include "mdp/ShardedBroker.h"
+#include "mdp/Worker.h"
+#include "mdp/utils.h"
+
+/* Broker, Workers and clients run in this process, each with own zmq
+ * context (inproc requires shared context) - ipc:// is used as local
+ * transport instead.
+ *
+ * Broker and Workers of a transport run until all its configurations are
+ * measured, every configuration registers its own service name. */
+
+namespace {
+
+using Clock      = std::chrono::steady_clock;
+using PayloadSeq = AsyncClient::PayloadSeq;
+using SizeSeq    = std::vector<std::size_t>;
+using StringSeq  = std::vector<std::string>;
+
+void help()
+{
+    std::cout
+        << "benchmark [-t ipc,tcp] [-w workers,...] [-c clients,...] "
+           "[-p payload_size,...] [-n requests_per_client] "
+           "[-i in_flight_per_client] [-s broker_shards] [-P tcp_port]"
+        << std::endl;
+}
+
+StringSeq split(const std::string &str)
+{
+    StringSeq seq;
+    std::istringstream is{str};
+
+    for (std::string item; std::getline(is, item, ',');)
+        if (!item.empty()) seq.push_back(item);
+    return seq;
+}
+
+/* positive number (zero only if allowed) */
+bool parseSize(const std::string &str, size_t &value, bool zero = false)
+{
+    const auto number = parseNumber(str);
+
+    if (!number || !zero && 0 == *number) return false;
+    value = *number;
+    return true;
+}
+
+/* comma separated numbers, false if empty or any is invalid */
+bool splitSize(const std::string &str, SizeSeq &seq, bool zero = false)
+{
+    SizeSeq parsed;
+
+    for (const auto &item : split(str))
+    {
+        if (!parseSize(item, parsed.emplace_back(), zero)) return false;
+    }
+    if (parsed.empty()) return false;
+    seq = std::move(parsed);
+    return true;
+}
+
+struct Config
+{
+    StringSeq transports{"ipc", "tcp"};
+    SizeSeq workers{1, 4};
+    SizeSeq clients{1, 8};
+    SizeSeq payloads{16, 1024, 65536};
+    std::size_t requests{10000};
+    std::size_t inFlight{1};
+    std::size_t shards{1};
+    std::size_t port{6070};
+};
+
+struct Result
+{
+    LatencyHistogram latency;
+    std::size_t errors{0};
+};
+
+bool success(const PayloadSeq &reply)
+{
+    return !reply.empty()
+        && MDP::Broker::Signature::statusSucess == reply.front();
+}
+
+/* Broker and Worker threads, stopped and joined on destruction */
+class Services
+{
+    using Stop = std::function<void()>;
+
+    std::vector<Stop> stopSeq_;
+    std::vector<std::thread> threadSeq_;
+
+    /* service object is shared by its thread and stop */
+    template <typename T, typename F>
+    void start(std::shared_ptr<T> service, F exec)
+    {
+        stopSeq_.push_back([service]() { service->stop(); });
+        threadSeq_.emplace_back([service, exec]() { exec(*service); });
+    }
+public:
+    Services() = default;
+    Services(const Services &)            = delete;
+    Services &operator=(const Services &) = delete;
+
+    ~Services()
+    {
+        /* all stop in parallel (each within its poll timeout) */
+        for (const auto &stop : stopSeq_) stop();
+        for (auto &thread : threadSeq_) thread.join();
+    }
+
+    void startBroker(const std::string &address, std::size_t shards)
+    {
+        BrokerConfig config;
+
+        /* clients * in flight requests can exceed number of workers */
+        config.requestQueue.depth    = 1 << 16;
+        config.requestQueue.overflow = RequestQueue::Overflow::RejectNewest;
+
+        if (1 < shards)
+        {
+            start(
+                std::make_shared<ShardedBroker>(shards, config),
+                [address](ShardedBroker &broker) { broker.exec(address); });
+        }
+        else
+        {
+            start(
+                std::make_shared<Broker>(config),
+                [address](Broker &broker) { broker.exec(address); });
+        }
+    }
+
+    void startWorker(const std::string &address, const std::string &name)
+    {
+        start(std::make_shared<Worker>(), [address, name](Worker &worker) {
+            worker.exec(address, name, [](zmqpp::message message) {
+                /* echo */
+                return message;
+            });
+        });
+    }
+};
+
+/* wait until service is available (or give up) */
+bool waitReady(const std::string &address, const std::string &serviceName)
+{
+    AsyncClient client{address, std::chrono::seconds{1}};
+
+    for (int i = 0; i < 100; ++i)
+    {
+        if (success(client.exec(serviceName, PayloadSeq{"ping"}).get()))
+        {
+            /* workers are started together - give remaining ones time to
+             * register (requests are queued by broker meanwhile) */
+            std::this_thread::sleep_for(std::chrono::milliseconds{200});
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    }
+    return false;
+}
+
+/* closed loop client: keeps inFlight requests outstanding */
+void runClient(
+    const std::string &address,
+    const std::string &serviceName,
+    const PayloadSeq &payload,
+    const Config &config,
+    Result &result)
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t sent      = 0;
+    std::size_t completed = 0;
+    /* destroyed (I/O thread joined) before state used by callbacks,
+     * requests lost with broker fail after 10s (counted as errors) */
+    AsyncClient client{address, std::chrono::seconds{10}};
+
+    std::unique_lock<std::mutex> lock{mutex};
+
+    while (config.requests > completed)
+    {
+        while (config.requests > sent && config.inFlight > sent - completed)
+        {
+            const auto start = Clock::now();
+
+            ++sent;
+            lock.unlock();
+            client.exec(serviceName, payload, [&, start](PayloadSeq reply) {
+                const auto latency = Clock::now() - start;
+                std::lock_guard<std::mutex> guard{mutex};
+
+                result.latency.record(
+                    std::chrono::duration_cast<LatencyHistogram::Duration>(
+                        latency));
+                if (!success(reply)) ++result.errors;
+                ++completed;
+                cv.notify_one();
+            });
+            lock.lock();
+        }
+        cv.wait(lock);
+    }
+}
+
+void run(
+    Services &services,
+    const std::string &transport,
+    const std::string &address,
+    std::size_t workers,
+    std::size_t clients,
+    std::size_t payloadSize,
+    const Config &config,
+    std::size_t no)
+{
+    const auto serviceName = "echo-" + std::to_string(no);
+
+    for (std::size_t i = 0; i < workers; ++i)
+        services.startWorker(address, serviceName);
+
+    if (!waitReady(address, serviceName))
+    {
+        std::cerr << serviceName << " workers not ready" << std::endl;
+        return;
+    }
+
+    const auto payload = PayloadSeq{std::string(payloadSize, 'x')};
+    std::vector<Result> results(clients);
+    std::vector<std::thread> threads;
+    const auto start = Clock::now();
+
+    for (auto &result : results)
+    {
+        threads.emplace_back(
+            runClient, std::cref(address), std::cref(serviceName),
+            std::cref(payload), std::cref(config), std::ref(result));
+    }
+    for (auto &thread : threads) thread.join();
+
+    const auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+    Result total;
+
+    for (const auto &result : results)
+    {
+        total.latency.merge(result.latency);
+        total.errors += result.errors;
+    }
+
+    std::cout << std::setw(9) << transport << std::setw(8) << workers
+              << std::setw(8) << clients << std::setw(9) << payloadSize
+              << std::setw(10) << total.latency.count() << std::setw(12)
+              << std::fixed << std::setprecision(0)
+              << total.latency.count() / elapsed.count() << std::setw(9)
+              << total.latency.percentile(0.5).count() << std::setw(9)
+              << total.latency.percentile(0.99).count() << std::setw(9)
+              << total.latency.percentile(0.999).count() << std::setw(8)
+              << total.errors << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *const argv[])
+{
+    Config config;
+
+    for (int c; -1 != (c = ::getopt(argc, argv, "ht:w:c:p:n:i:s:P:"));)
+    {
+        bool valid = true;
+
+        switch (c)
+        {
+        case 'h':
+            help();
+            return EXIT_SUCCESS;
+            break;
+        case 't': config.transports = split(optarg); break;
+        case 'w': valid = splitSize(optarg, config.workers); break;
+        case 'c': valid = splitSize(optarg, config.clients); break;
+        /* empty payload is valid request */
+        case 'p': valid = splitSize(optarg, config.payloads, true); break;
+        case 'n': valid = parseSize(optarg, config.requests); break;
+        case 'i': valid = parseSize(optarg, config.inFlight); break;
+        case 's': valid = parseSize(optarg, config.shards); break;
+        case 'P':
+            valid = parseSize(optarg, config.port) && 65535 >= config.port;
+            break;
+        case ':':
+        case '?':
+        default: return EXIT_FAILURE; break;
+        }
+
+        if (!valid)
+        {
+            help();
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << std::setw(9) << "transport" << std::setw(8) << "workers"
+              << std::setw(8) << "clients" << std::setw(9) << "payload"
+              << std::setw(10) << "requests" << std::setw(12) << "req/s"
+              << std::setw(9) << "p50[us]" << std::setw(9) << "p99[us]"
+              << std::setw(9) << "p999[us]" << std::setw(8) << "errors"
+              << std::endl;
+
+    std::size_t no = 0;
+
+    for (const auto &transport : config.transports)
+    {
+        std::string address;
+
+        if ("ipc" == transport)
+        {
+            address = "ipc:///tmp/mdp-benchmark-" + std::to_string(::getpid());
+        }
+        else if ("tcp" == transport)
+        {
+            address = "tcp://127.0.0.1:" + std::to_string(config.port++);
+        }
+        else
+        {
+            std::cerr << "unsupported transport " << transport << std::endl;
+            continue;
+        }
+
+        {
+            Services services;
+
+            services.startBroker(address, config.shards);
+
+            for (const auto workers : config.workers)
+                for (const auto clients : config.clients)
+                    for (const auto payloadSize : config.payloads)
+                        run(services, transport, address, workers, clients,
+                            payloadSize, config, no++);
+        }
+
+        if ("ipc" == transport) ::unlink(address.substr(6).c_str());
+    }
+
+    return EXIT_SUCCESS;
+}
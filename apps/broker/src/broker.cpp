@@ -1,17 +1,114 @@
+#include <chrono>
 #include <iostream>
 #include <string>
 
 #include <unistd.h>
 
 #include <mdp/Broker.h>
+#include <mdp/FastTrace.h>
+#include <mdp/ShardedBroker.h>
+#include <mdp/utils.h>
 
-void help() { std::cout << "broker -a broker_address" << std::endl; }
+void help()
+{
+    std::cout << "broker -a broker_address [-q queue_depth] "
+                 "[-d queue_deadline_ms] [-o reject|drop|busy] [-s shards] "
+                 "[-b batch] [-O outbound_depth] [-H heartbeat_ms] "
+                 "[-L liveness] "
+                 "[-S service=heartbeat_ms[:liveness] ...] "
+                 "[-C service=ttl_ms[:capacity[:bytes]] ...] [-c service ...]"
+              << std::endl
+              << "  -s: mmi.stats and mmi.metrics without service name "
+                 "report shard 0 only"
+              << std::endl;
+}
+
+bool parseOverflow(const std::string &str, RequestQueue::Overflow &overflow)
+{
+    if ("reject" == str) overflow = RequestQueue::Overflow::RejectNewest;
+    else if ("drop" == str) overflow = RequestQueue::Overflow::DropOldest;
+    else if ("busy" == str) overflow = RequestQueue::Overflow::BusyReply;
+    else return false;
+    return true;
+}
+
+/* positive number */
+bool parsePositive(const std::string &str, size_t &value)
+{
+    const auto number = parseNumber(str);
+
+    if (!number || 0 == *number) return false;
+    value = *number;
+    return true;
+}
+
+bool parsePositive(const std::string &str, std::chrono::milliseconds &value)
+{
+    size_t ms = 0;
+
+    if (!parsePositive(str, ms)) return false;
+    value = std::chrono::milliseconds{ms};
+    return true;
+}
+
+/* first[:second] (second is left if omitted) */
+template <typename T>
+bool parsePair(const std::string &str, T &first, size_t &second)
+{
+    const auto colon = str.find(':');
+
+    if (!parsePositive(str.substr(0, colon), first)) return false;
+    return std::string::npos == colon
+           || parsePositive(str.substr(colon + 1), second);
+}
+
+/* service=heartbeat_ms[:liveness] */
+bool parseServiceHeartbeat(const std::string &str, BrokerConfig &config)
+{
+    const auto eq = str.find('=');
+
+    if (std::string::npos == eq || 0 == eq) return false;
+
+    HeartbeatConfig heartbeat;
+
+    if (!parsePair(str.substr(eq + 1), heartbeat.period, heartbeat.liveness))
+        return false;
+
+    config.serviceHeartbeat[str.substr(0, eq)] = heartbeat;
+    return true;
+}
+
+/* service=ttl_ms[:capacity[:bytes]] */
+bool parseServiceCache(const std::string &str, BrokerConfig &config)
+{
+    const auto eq = str.find('=');
+
+    if (std::string::npos == eq || 0 == eq) return false;
+
+    const auto value  = str.substr(eq + 1);
+    const auto colon  = value.find(':');
+    const auto second = std::string::npos == colon
+                            ? colon
+                            : value.find(':', colon + 1);
+    ResponseCache::Config cache;
+
+    if (!parsePair(value.substr(0, second), cache.ttl, cache.capacity))
+        return false;
+    if (std::string::npos != second
+        && !parsePositive(value.substr(second + 1), cache.bytes))
+        return false;
+
+    config.serviceCache[str.substr(0, eq)] = cache;
+    return true;
+}
 
 int main(int argc, char *const argv[])
 {
     std::string address;
+    BrokerConfig config;
+    std::size_t shards = 1;
 
-    for (int c; -1 != (c = ::getopt(argc, argv, "ha:"));)
+    for (int c; -1 != (c = ::getopt(argc, argv, "ha:q:d:o:s:b:O:H:L:S:C:c:"));)
     {
         switch (c)
         {
@@ -20,6 +117,83 @@ int main(int argc, char *const argv[])
             return EXIT_SUCCESS;
             break;
         case 'a': address = optarg; break;
+        case 'q':
+        {
+            /* 0 - queueing disabled */
+            const auto depth = parseNumber(optarg);
+
+            if (!depth)
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            config.requestQueue.depth = *depth;
+            break;
+        }
+        case 'd':
+            if (!parsePositive(optarg, config.requestQueue.deadline))
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'o':
+            if (!parseOverflow(optarg, config.requestQueue.overflow))
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            break;
+        case 's':
+            if (!parsePositive(optarg, shards))
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'b':
+            if (!parsePositive(optarg, config.batch))
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'O':
+            if (!parsePositive(optarg, config.outbound.depth))
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'H':
+            if (!parsePositive(optarg, config.heartbeat.period))
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'L':
+            if (!parsePositive(optarg, config.heartbeat.liveness))
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'S':
+            if (!parseServiceHeartbeat(optarg, config))
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'C':
+            if (!parseServiceCache(optarg, config))
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'c': config.serviceCoalesce.insert(optarg); break;
         case ':':
         case '?':
         default: return EXIT_FAILURE; break;
@@ -32,11 +206,23 @@ int main(int argc, char *const argv[])
         return EXIT_FAILURE;
     }
 
+    /* formats hot path trace records off broker thread */
+    FastTrace::Writer traceWriter{std::clog};
+
     try
     {
-        Broker broker;
+        if (1 < shards)
+        {
+            ShardedBroker broker{shards, config};
+
+            broker.exec(address);
+        }
+        else
+        {
+            Broker broker{config};
 
-        broker.exec(address);
+            broker.exec(address);
+        }
     }
     catch (const std::exception &except)
     {
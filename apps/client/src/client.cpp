@@ -6,13 +6,14 @@
 #include <nlohmann/json.hpp>
 
 #include "mdp/Client.h"
+#include "mdp/utils.h"
 
 using json = nlohmann::json;
 
 void help()
 {
     std::cout << "client -a broker_address -s service_name -i [input.json|-] "
-                 "[-o output]"
+                 "[-o output] [-c chunk_size]"
               << std::endl;
 }
 
@@ -22,8 +23,9 @@ int main(int argc, char *const argv[])
     std::string serviceName;
     std::string iname;
     std::string oname;
+    size_t chunkSize = 0;
 
-    for (int c; -1 != (c = ::getopt(argc, argv, "ha:s:i:o:"));)
+    for (int c; -1 != (c = ::getopt(argc, argv, "ha:s:i:o:c:"));)
     {
         switch (c)
         {
@@ -35,6 +37,18 @@ int main(int argc, char *const argv[])
         case 's': serviceName = optarg ? optarg : ""; break;
         case 'i': iname = optarg ? optarg : ""; break;
         case 'o': oname = optarg ? optarg : ""; break;
+        case 'c':
+        {
+            const auto n = parseNumber(optarg ? optarg : "");
+
+            if (!n || 0 == *n)
+            {
+                help();
+                return EXIT_FAILURE;
+            }
+            chunkSize = *n;
+            break;
+        }
         case ':':
         case '?':
         default: return EXIT_FAILURE; break;
@@ -49,18 +63,36 @@ int main(int argc, char *const argv[])
 
     try
     {
-        json input;
+        Client client;
+        Client::PayloadSeq reply;
+
+        if (0 < chunkSize)
+        {
+            /* input is sent as is (not parsed) in chunks */
+            std::ifstream ifile;
 
-        if ("-" == iname) std::cin >> input;
-        else std::ifstream{iname} >> input;
+            if ("-" != iname)
+            {
+                ifile.open(iname, std::ios::binary);
+                ENSURE(ifile.is_open() && " can not open input", RuntimeError);
+            }
 
-        Client::PayloadSeq payloadSeq;
+            reply = client.upload(
+                address, serviceName, "-" == iname ? std::cin : ifile,
+                chunkSize);
+        }
+        else
+        {
+            json input;
 
-        payloadSeq.emplace_back(input.dump());
+            if ("-" == iname) std::cin >> input;
+            else std::ifstream{iname} >> input;
 
-        Client client;
+            Client::PayloadSeq payloadSeq;
 
-        const auto reply = client.exec(address, serviceName, payloadSeq);
+            payloadSeq.emplace_back(input.dump());
+            reply = client.exec(address, serviceName, payloadSeq);
+        }
 
         ENSURE(!reply.empty(), RuntimeError);
 
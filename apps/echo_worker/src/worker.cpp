@@ -1,19 +1,40 @@
 #include <unistd.h>
 
+#include "mdp/FastTrace.h"
 #include "mdp/Worker.h"
+#include "mdp/utils.h"
 
 void help()
 {
-    std::cout << "worker -a broker_address -s service_name" << std::endl;
+    std::cout << "worker -a broker_address -s service_name [-n concurrency]"
+                 " [-c credits] [-H heartbeat_ms] [-L liveness] [-i]"
+              << std::endl;
+}
+
+/* positive number (zero only if allowed) */
+bool parseSize(const std::string &str, size_t &value, bool zero = false)
+{
+    const auto number = parseNumber(str);
+
+    if (!number || !zero && 0 == *number) return false;
+    value = *number;
+    return true;
 }
 
 int main(int argc, char *const argv[])
 {
     std::string address;
     std::string serviceName;
+    size_t concurrency = 1;
+    size_t credits     = 0;
+    size_t heartbeat   = 0;
+    size_t liveness    = 0;
+    bool inlined       = false;
 
-    for (int c; -1 != (c = ::getopt(argc, argv, "ha:s:"));)
+    for (int c; -1 != (c = ::getopt(argc, argv, "ha:s:n:c:H:L:i"));)
     {
+        bool valid = true;
+
         switch (c)
         {
         case 'h':
@@ -22,26 +43,46 @@ int main(int argc, char *const argv[])
             break;
         case 'a': address = optarg; break;
         case 's': serviceName = optarg; break;
+        case 'n': valid = parseSize(optarg, concurrency); break;
+        case 'c': valid = parseSize(optarg, credits); break;
+        /* 0 - heartbeat is set by broker */
+        case 'H': valid = parseSize(optarg, heartbeat, true); break;
+        case 'L': valid = parseSize(optarg, liveness); break;
+        case 'i': inlined = true; break;
         case ':':
         case '?':
         default: return EXIT_FAILURE; break;
         }
+
+        if (!valid)
+        {
+            help();
+            return EXIT_FAILURE;
+        }
     }
 
-    if (address.empty() || serviceName.empty())
+    if (address.empty() || serviceName.empty()
+        || 0 != credits && concurrency > credits
+        || inlined && 1 != concurrency)
     {
         help();
         return EXIT_FAILURE;
     }
 
+    /* formats hot path trace records off worker thread */
+    FastTrace::Writer traceWriter{std::clog};
+
     try
     {
-        Worker worker;
+        Worker worker{std::chrono::milliseconds{heartbeat}, liveness};
+        const auto echo = [](zmqpp::message message) { return message; };
 
-        worker.exec(address, serviceName, [](zmqpp::message message) {
-            /* echo */
-            return message;
-        });
+        if (inlined)
+        {
+            worker.execInline(
+                address, serviceName, echo, 0 == credits ? 1 : credits);
+        }
+        else { worker.exec(address, serviceName, echo, concurrency, credits); }
     }
     catch (const EnsureException &except)
     {
@@ -4,16 +4,26 @@
 
 #include <zmqpp/zmqpp.hpp>
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
+#include "mdp/BrokerConfig.h"
+#include "mdp/BrokerMetrics.h"
 #include "mdp/BrokerTasks.h"
 #include "mdp/MDP.h"
+#include "mdp/OutboundQueue.h"
+#include "mdp/RequestQueue.h"
+#include "mdp/ResponseCache.h"
+#include "mdp/TimerQueue.h"
 #include "mdp/WorkerPool.h"
 #include "mdp/ZMQBrokerContext.h"
 #include "mdp/ZMQIdentity.h"
@@ -21,19 +31,28 @@
 struct Broker
 {
 
+    using Message          = MDP::Message;
     using MessageHandle    = MDP::MessageHandle;
     using ZMQContext       = ZMQBrokerContext;
     using ZMQContextHandle = std::unique_ptr<ZMQContext>;
+    using Clock            = std::chrono::steady_clock;
+    using TimePoint        = Clock::time_point;
+    using PayloadSeq       = std::vector<std::string>;
 
     enum class Tag
     {
         ClientRequest,
+        ClientChunk,
         ClientReply,
         WorkerReady,
         WorkerRequest,
         WorkerReply,
+        WorkerPartial,
+        WorkerAccept,
+        WorkerFailure,
         WorkerHeartbeat,
         WorkerDisconnect,
+        MMIRequest,
         Unsupported
     };
 
@@ -53,32 +72,185 @@ struct Broker
         { }
     };
 
-    Broker(std::chrono::milliseconds timeout = std::chrono::seconds{3});
+    explicit Broker(BrokerConfig config = BrokerConfig{});
+    /* standalone broker - ROUTER socket bound to address */
     void exec(const std::string &address);
+    /* broker shard - socket connected to ShardedBroker front (inproc address
+     * within shared context) */
+    void exec(zmqpp::context &, const std::string &address);
+    /* exec returns within poll timeout (may be called from any thread) */
+    void stop();
+    /* message type deduced from frames (Unsupported if malformed) */
+    static Tag classify(const Message &);
+    /* max credit window single worker can advertise */
+    static constexpr size_t maxCredits = 1024;
+    /* services handled by broker itself (Majordomo Management Interface) */
+    static constexpr const char *mmiPrefix  = "mmi.";
+    static constexpr const char *mmiService = "mmi.service";
+    static constexpr const char *mmiWorkers = "mmi.workers";
+    static constexpr const char *mmiStats   = "mmi.stats";
+    static constexpr const char *mmiMetrics = "mmi.metrics";
 private:
+    std::atomic<bool> stopped_{false};
     std::chrono::milliseconds timeout_;
+    size_t batch_;
+    HeartbeatConfig heartbeat_;
+    std::map<std::string, HeartbeatConfig> serviceHeartbeat_;
+    HeartbeatConfig minHeartbeat_;
+    HeartbeatConfig maxHeartbeat_;
     ZMQContextHandle zmqContextHandle_{};
     WorkerPool workerPool_{};
-    BrokerTasks brokerTasks_{};
+    BrokerTasks brokerTasks_{workerPool_};
+    RequestQueue requestQueue_;
+    /* heartbeat send/expiry deadlines of workers */
+    TimerQueue<ZMQIdentity> workerTimers_{};
 
+    /* client deadline of request dispatched to worker */
+    struct TaskTimer
+    {
+        ZMQIdentity worker_;
+        /* client address key */
+        std::string key_;
+    };
+
+    TimerQueue<TaskTimer> taskTimers_{};
+    /* timers of replied tasks stay in queue until their deadline - purged
+     * once queue grows past this size (twice live timers after purge) */
+    size_t taskTimersPurge_{minTaskTimersPurge};
+    BrokerMetrics metrics_{};
+    /* services with cached replies */
+    std::unordered_map<std::string, ResponseCache> cacheMap_{};
+
+    /* task of in-flight request (identical requests are attached to it) */
+    struct Flight
+    {
+        ZMQIdentity worker_;
+        /* client address key */
+        std::string key_;
+    };
+
+    /* request key -> Flight */
+    using FlightMap = std::unordered_map<std::string, Flight>;
+
+    /* services with coalesced requests */
+    std::unordered_map<std::string, FlightMap> flightMap_{};
+    /* chunked request with chunks to come */
+    struct Upload
+    {
+        ZMQIdentity worker_;
+        /* number of next chunk (others are out of order) */
+        size_t next_;
+    };
+
+    /* client address key -> Upload (chunks are forwarded as they arrive,
+     * never buffered) */
+    std::unordered_map<std::string, Upload> chunkedMap_{};
+    OutboundQueue outbound_;
+    /* last flush sent at least one queued message */
+    bool outboundProgress_{false};
+    /* poller waits for writable socket */
+    bool pollOut_{false};
+
+    static constexpr std::chrono::milliseconds outboundRetry{10};
+    static constexpr size_t minTaskTimersPurge{1024};
+
+    void exec(const std::function<ZMQContextHandle()> &);
+    /* receive and handle batch of messages */
+    void drain();
     void onMessage(MessageHandle);
     void onClientMessage(MessageHandle);
-    void onWorkerMessage(MessageHandle);
     /* Client */
-    void dispatch(Tagged<Tag::ClientRequest>);
+    /* deadline - client deadline (TimePoint::max() if none) */
+    void dispatch(Tagged<Tag::ClientRequest>, TimePoint deadline);
+    /* requestKey - reply is cached (and request coalesced) if not empty */
+    void dispatch(
+        Tagged<Tag::ClientRequest>,
+        WorkerPool::Worker &,
+        TimePoint deadline,
+        std::string requestKey);
+    /* chunk 0 is dispatched as request (to worker accepting chunked
+     * requests) */
+    void dispatch(Tagged<Tag::ClientChunk>);
     void dispatch(Tagged<Tag::ClientReply>);
+    void dispatchPending(const std::string &serviceName);
+    void dispatch(Tagged<Tag::MMIRequest>);
     /* Worker */
     void dispatch(Tagged<Tag::WorkerReady>);
     void dispatch(
         Tagged<Tag::WorkerRequest>,
         WorkerPool::Worker &,
-        ZMQIdentity clientIdentity);
+        MDP::ClientAddress,
+        TimePoint deadline,
+        std::string requestKey);
     void dispatch(Tagged<Tag::WorkerReply>);
+    void dispatch(Tagged<Tag::WorkerPartial>);
+    void dispatch(Tagged<Tag::WorkerAccept>);
+    void dispatch(Tagged<Tag::WorkerFailure>);
     void dispatch(Tagged<Tag::WorkerHeartbeat>);
     void dispatch(Tagged<Tag::WorkerDisconnect>);
     /* Misc */
+    /* client request is chunk 0 of chunked request */
+    static bool chunked(const Message &);
+    /* numeric READY property, nullopt if omitted or invalid */
+    static std::optional<size_t> readyNumber(const Message &, const char *key);
+    static size_t readyCredits(const Message &);
+    /* service heartbeat or worker proposal (within bounds), true if worker
+     * announced heartbeat (MDP default for plain MDP workers) */
+    std::pair<HeartbeatConfig, bool>
+    readyHeartbeat(const std::string &serviceName, const Message &) const;
+    std::chrono::milliseconds pollTimeout() const;
+    /* nullptr if service replies are not cached */
+    ResponseCache *findCache(const std::string &serviceName);
+    /* nullptr if service requests are not coalesced */
+    FlightMap *findFlights(const std::string &serviceName);
+    /* key of client request body (empty if service neither caches nor
+     * coalesces) */
+    std::string
+    requestKey(const std::string &serviceName, const Message &request);
+    /* true if client was attached to identical request in flight */
+    bool coalesce(
+        const std::string &serviceName,
+        const std::string &requestKey,
+        const MDP::ClientAddress &,
+        TimePoint deadline);
+    /* task is done - identical requests are no longer attached to it */
+    void land(const std::string &serviceName, const BrokerTasks::TaskInfo &);
+    /* task is done - chunks still to come are discarded */
+    void unchunk(const BrokerTasks::TaskInfo &);
+    void schedule(WorkerPool::Worker &);
+    void schedule(TaskTimer, TimePoint deadline);
     void checkExpired();
+    void onTimer(ZMQIdentity, TimePoint deadline, TimePoint now);
+    void onTaskTimer(TaskTimer, TimePoint deadline);
+    void checkPendingExpired(TimePoint now);
     void purge(ZMQIdentity);
-    void sendHeartbeatIfNeeded();
+    void onTasksFailed(const std::string &serviceName, BrokerTasks::TaskSeq);
+    /* MMI reply body: status followed by optional data, argument - service
+     * name (frame following MMI service name, empty if none) */
+    using MMIHandler = PayloadSeq (Broker::*)(const std::string &) const;
+
+    struct MMIEntry
+    {
+        const char *serviceName_;
+        MMIHandler handler_;
+    };
+
+    /* supported MMI services - new one is single entry (and handler) */
+    static const MMIEntry mmiTable[];
+
+    PayloadSeq onMMIService(const std::string &serviceName) const;
+    PayloadSeq onMMIWorkers(const std::string &serviceName) const;
+    PayloadSeq onMMIStats(const std::string &serviceName) const;
+    PayloadSeq onMMIMetrics(const std::string &serviceName) const;
+    std::string formatStats(const std::string &serviceName) const;
+    std::string formatMetrics(const std::string &serviceName) const;
+    void sendHeartbeatIfNeeded(WorkerPool::Worker &, TimePoint now);
     void dispatch(Tagged<Tag::Unsupported>);
+    /* Outbound */
+    /* send or queue message to peer (frame 0), false if peer queue is full */
+    bool post(Message);
+    /* false if send would block */
+    bool trySend(Message &);
+    void flush();
+    void pollOut(bool enabled);
 };
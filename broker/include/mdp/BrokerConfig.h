@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+
+#include "mdp/MutualHeartbeatMonitor.h"
+#include "mdp/OutboundQueue.h"
+#include "mdp/RequestQueue.h"
+#include "mdp/ResponseCache.h"
+
+struct HeartbeatConfig
+{
+    std::chrono::milliseconds period{std::chrono::seconds{3}};
+    /* missed heartbeats after which peer is considered dead */
+    size_t liveness{MutualHeartbeatMonitor::defaultLiveness};
+};
+
+struct BrokerConfig
+{
+    /* poller timeout (upper bound of housekeeping period) */
+    std::chrono::milliseconds timeout{std::chrono::seconds{3}};
+    /* max number of messages received per poll wakeup (housekeeping runs
+     * once per batch) */
+    size_t batch{64};
+    /* pending client requests (waiting for an idle worker) */
+    RequestQueue::Config requestQueue{};
+    /* messages to peers which do not keep up (socket would block) */
+    OutboundQueue::Config outbound{};
+    /* heartbeat of workers which announce it in READY (plain MDP workers
+     * keep MDP default), service heartbeat overrides it and worker may
+     * propose its own (clamped to min, max) */
+    HeartbeatConfig heartbeat{};
+    std::map<std::string, HeartbeatConfig> serviceHeartbeat{};
+    HeartbeatConfig minHeartbeat{std::chrono::milliseconds{10}, 1};
+    HeartbeatConfig maxHeartbeat{std::chrono::minutes{10}, 100};
+    /* replies of idempotent services (opt-in) are cached by request body and
+     * answered by broker itself */
+    std::map<std::string, ResponseCache::Config> serviceCache{};
+    /* identical requests (same body) of idempotent services are coalesced
+     * while in flight - single worker reply answers all of them */
+    std::set<std::string> serviceCoalesce{};
+};
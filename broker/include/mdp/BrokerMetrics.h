@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include "mdp/LatencyHistogram.h"
+
+/* per service counters and dispatch -> reply latency, updated inline by
+ * Broker (no locking - single broker thread) and reported via MMI */
+struct BrokerMetrics
+{
+    struct Service
+    {
+        uint64_t requests_{0};
+        uint64_t replies_{0};
+        /* rejected - no idle worker, queueing disabled */
+        uint64_t busy_{0};
+        /* rejected or dropped - queue full */
+        uint64_t overloaded_{0};
+        /* expired in queue */
+        uint64_t timeouts_{0};
+        /* worker failed (disconnected or expired) with request in flight */
+        uint64_t failures_{0};
+        /* rejected - worker outbound queue full */
+        uint64_t stalled_{0};
+        /* attached to identical request in flight (not dispatched) */
+        uint64_t coalesced_{0};
+        /* explicit heartbeats sent to idle workers (suppressed while
+         * requests flow) */
+        uint64_t heartbeats_{0};
+        /* chunks of chunked requests forwarded to workers */
+        uint64_t chunks_{0};
+        /* BrokerTasks append -> remove */
+        LatencyHistogram latency_;
+    };
+
+    using ServiceName = std::string;
+    using ServiceMap  = std::unordered_map<ServiceName, Service>;
+
+    ServiceMap serviceMap_;
+    /* requests for service without workers */
+    uint64_t unsupported_{0};
+    /* replies dropped - client outbound queue full */
+    uint64_t dropped_{0};
+
+    Service &service(const ServiceName &serviceName)
+    {
+        return serviceMap_[serviceName];
+    }
+
+    const Service *findService(const ServiceName &serviceName) const
+    {
+        const auto i = serviceMap_.find(serviceName);
+        return std::end(serviceMap_) == i ? nullptr : &i->second;
+    }
+
+    /* single line of space separated key=value pairs */
+    static std::string format(const ServiceName &serviceName, const Service &s)
+    {
+        std::ostringstream os;
+
+        os << "service=" << serviceName << " requests=" << s.requests_
+           << " replies=" << s.replies_ << " busy=" << s.busy_
+           << " overloaded=" << s.overloaded_ << " timeouts=" << s.timeouts_
+           << " failures=" << s.failures_ << " stalled=" << s.stalled_
+           << " coalesced=" << s.coalesced_
+           << " heartbeats=" << s.heartbeats_ << " chunks=" << s.chunks_
+           << " p50_us=" << s.latency_.percentile(0.5).count()
+           << " p99_us=" << s.latency_.percentile(0.99).count()
+           << " p999_us=" << s.latency_.percentile(0.999).count()
+           << " max_us=" << s.latency_.max().count();
+        return os.str();
+    }
+};
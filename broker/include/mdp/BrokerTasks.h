@@ -1,61 +1,93 @@
 #pragma once
 
-#include <map>
+#include <algorithm>
 
 #include "ensure/Ensure.h"
 #include "mdp/Except.h"
+#include "mdp/MDP.h"
 #include "mdp/WorkerPool.h"
 #include "mdp/ZMQIdentity.h"
 
+/* tasks are kept with workers they were dispatched to, lookup uses
+ * WorkerPool identity index (no separate map) */
 struct BrokerTasks
 {
     using WorkerIterator = WorkerPool::WorkerSeq::iterator;
-
-    struct TaskInfo
-    {
-        WorkerIterator workerIterator_;
-        ZMQIdentity clientIdentity_;
-
-        TaskInfo(WorkerIterator workerIterator, ZMQIdentity clientIdentity)
-            : workerIterator_{workerIterator}
-            , clientIdentity_{clientIdentity}
-        { }
-
-        TaskInfo(const TaskInfo &)            = delete;
-        TaskInfo &operator=(const TaskInfo &) = delete;
-
-        TaskInfo(TaskInfo &&)            = default;
-        TaskInfo &operator=(TaskInfo &&) = default;
-    };
-
-    using TaskInfoMap = std::map<ZMQIdentity, TaskInfo>;
+    using TaskInfo       = WorkerPool::Worker::Task;
+    using TaskSeq        = WorkerPool::Worker::TaskSeq;
 private:
-    TaskInfoMap taskInfoMap_;
+    WorkerPool &workerPool_;
 public:
+    explicit BrokerTasks(WorkerPool &workerPool)
+        : workerPool_{workerPool}
+    { }
+
+    BrokerTasks(const BrokerTasks &)            = delete;
+    BrokerTasks &operator=(const BrokerTasks &) = delete;
+
+    /* worker has any task in flight */
     bool valid(const ZMQIdentity &identity) const
     {
-        return taskInfoMap_.count(identity);
+        return workerPool_.contains(identity)
+            && !workerPool_.findWorker(identity)->taskSeq_.empty();
     }
 
-    void append(WorkerIterator workerIterator, ZMQIdentity clientIdentity)
+    void append(
+        WorkerIterator workerIterator,
+        MDP::ClientAddress clientAddress,
+        MutualHeartbeatMonitor::TimePoint deadline
+        = MutualHeartbeatMonitor::TimePoint::max(),
+        std::string requestKey = {})
     {
         ENSURE(
-            0 == taskInfoMap_.count(workerIterator->identity_),
+            workerIterator->credits_ > workerIterator->taskSeq_.size(),
             WorkerDuplicate);
 
-        taskInfoMap_.emplace(std::make_pair(
-            workerIterator->identity_,
-            TaskInfo{workerIterator, clientIdentity}));
+        workerIterator->taskSeq_.push_back(TaskInfo{
+            std::move(clientAddress), MutualHeartbeatMonitor::Clock::now(),
+            deadline, false, std::move(requestKey)});
     }
 
-    void remove(const ZMQIdentity &workerIdentity)
+    /* task matching client address key, nullptr if none */
+    TaskInfo *find(const ZMQIdentity &workerIdentity, const std::string &key)
     {
-        taskInfoMap_.erase(workerIdentity);
+        if (!workerPool_.contains(workerIdentity)) return nullptr;
+
+        auto &taskSeq = workerPool_.findWorker(workerIdentity)->taskSeq_;
+        const auto i  = std::find_if(
+            std::begin(taskSeq), std::end(taskSeq), [&key](const TaskInfo &t) {
+                return key == t.clientAddress_.key();
+            });
+
+        return std::end(taskSeq) == i ? nullptr : &*i;
     }
 
-    const TaskInfo &taskInfo(const ZMQIdentity &workerIdentity) const
+    /* remove task matching client address key (as echoed by worker) */
+    TaskInfo remove(const ZMQIdentity &workerIdentity, const std::string &key)
     {
         ENSURE(valid(workerIdentity), IdentityInvalid);
-        return taskInfoMap_.at(workerIdentity);
+
+        auto &taskSeq = workerPool_.findWorker(workerIdentity)->taskSeq_;
+        const auto i  = std::find_if(
+            std::begin(taskSeq), std::end(taskSeq), [&key](const TaskInfo &t) {
+                return key == t.clientAddress_.key();
+            });
+
+        ENSURE(std::end(taskSeq) != i, IdentityInvalid);
+
+        auto taskInfo = std::move(*i);
+
+        taskSeq.erase(i);
+        return taskInfo;
+    }
+
+    /* remove all tasks of worker (disconnected or expired) */
+    TaskSeq remove(const ZMQIdentity &workerIdentity)
+    {
+        TaskSeq taskSeq;
+
+        if (workerPool_.contains(workerIdentity))
+            taskSeq.swap(workerPool_.findWorker(workerIdentity)->taskSeq_);
+        return taskSeq;
     }
 };
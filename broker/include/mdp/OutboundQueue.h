@@ -0,0 +1,108 @@
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+
+#include "ensure/Ensure.h"
+#include "mdp/Except.h"
+#include "mdp/MDP.h"
+#include "mdp/ZMQIdentity.h"
+
+/* bounded per peer queue of messages which could not be sent without
+ * blocking (peer reached high water mark), drained in order when socket
+ * becomes writable */
+struct OutboundQueue
+{
+    using Message    = MDP::Message;
+    using MessageSeq = std::deque<Message>;
+    using PeerMap    = std::unordered_map<ZMQIdentity, MessageSeq>;
+
+    struct Config
+    {
+        /* max number of queued messages per peer */
+        size_t depth{1024};
+    };
+private:
+    Config config_;
+    PeerMap peerMap_;
+    /* total number of queued messages */
+    size_t size_{0};
+public:
+    explicit OutboundQueue(Config config)
+        : config_{config}
+    {
+        ENSURE(0 < config_.depth, RuntimeError);
+    }
+
+    OutboundQueue(const OutboundQueue &)            = delete;
+    OutboundQueue &operator=(const OutboundQueue &) = delete;
+
+    const Config &config() const { return config_; }
+    bool empty() const { return 0 == size_; }
+    size_t size() const { return size_; }
+
+    /* peer is blocked - new messages have to be queued to keep order */
+    bool queued(const ZMQIdentity &peer) const
+    {
+        return 0 < peerMap_.count(peer);
+    }
+
+    bool full(const ZMQIdentity &peer) const
+    {
+        const auto i = peerMap_.find(peer);
+
+        return std::end(peerMap_) != i && config_.depth <= i->second.size();
+    }
+
+    /* false if peer queue is full (message is not queued) */
+    bool push(const ZMQIdentity &peer, Message message)
+    {
+        auto &messageSeq = peerMap_[peer];
+
+        if (config_.depth <= messageSeq.size()) return false;
+
+        messageSeq.push_back(std::move(message));
+        ++size_;
+        return true;
+    }
+
+    /* sends queued messages of every peer until peer would block,
+     * trySend(Message &) returns false if message was not sent, returns
+     * number of messages sent */
+    template <typename F>
+    size_t drain(F trySend)
+    {
+        size_t num = 0;
+
+        for (auto i = std::begin(peerMap_); std::end(peerMap_) != i;)
+        {
+            auto &messageSeq = i->second;
+
+            while (!messageSeq.empty() && trySend(messageSeq.front()))
+            {
+                messageSeq.pop_front();
+                ++num;
+            }
+
+            if (messageSeq.empty()) i = peerMap_.erase(i);
+            else ++i;
+        }
+        size_ -= num;
+        return num;
+    }
+
+    /* drop queued messages of peer (e.g. disconnected worker), returns
+     * number of dropped messages */
+    size_t remove(const ZMQIdentity &peer)
+    {
+        const auto i = peerMap_.find(peer);
+
+        if (std::end(peerMap_) == i) return 0;
+
+        const auto num = i->second.size();
+
+        peerMap_.erase(i);
+        size_ -= num;
+        return num;
+    }
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+
+#include "ensure/Ensure.h"
+#include "mdp/Except.h"
+#include "mdp/MDP.h"
+#include "mdp/ZMQIdentity.h"
+
+/* bounded per service queue of client requests waiting for an idle worker */
+struct RequestQueue
+{
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    enum class Overflow
+    {
+        begin,
+        /* reject request which does not fit into queue */
+        RejectNewest = begin,
+        /* reject oldest queued request to make room for newest */
+        DropOldest,
+        /* reply "service busy" (same as with queueing disabled) */
+        BusyReply,
+        end
+    };
+
+    friend std::ostream &operator<<(std::ostream &os, const Overflow &o)
+    {
+        static const char *name[] = {"reject", "drop", "busy"};
+        os << (Overflow::begin <= o && Overflow::end > o ? name[int(o)] : "?");
+        return os;
+    }
+
+    struct Config
+    {
+        /* max number of queued requests per service (0 - queueing disabled) */
+        size_t depth{0};
+        /* max time request can wait in queue for an idle worker */
+        std::chrono::milliseconds deadline{std::chrono::seconds{9}};
+        Overflow overflow{Overflow::BusyReply};
+    };
+
+    struct Request
+    {
+        MDP::ClientAddress clientAddress_;
+        MDP::MessageHandle handle_;
+        /* max time request can wait in queue (nearer of queue deadline and
+         * client deadline) */
+        TimePoint deadline_;
+        /* client deadline (TimePoint::max() if none), still applies after
+         * request is dispatched to worker */
+        TimePoint clientDeadline_;
+
+        Request(
+            MDP::ClientAddress clientAddress,
+            MDP::MessageHandle handle,
+            TimePoint deadline,
+            TimePoint clientDeadline)
+            : clientAddress_{std::move(clientAddress)}
+            , handle_{std::move(handle)}
+            , deadline_{deadline}
+            , clientDeadline_{clientDeadline}
+        { }
+    };
+
+    using ServiceName = std::string;
+    /* FIFO - std::list iterators stay valid for deadline index */
+    using RequestSeq = std::list<Request>;
+    using ServiceMap = std::map<ServiceName, RequestSeq>;
+
+    struct Expiry
+    {
+        ServiceMap::iterator service_;
+        RequestSeq::iterator request_;
+    };
+
+    /* queued requests in deadline order (client deadlines make FIFO order
+     * differ from deadline order) */
+    using ExpiryMap = std::multimap<TimePoint, Expiry>;
+private:
+    Config config_;
+    ServiceMap serviceMap_;
+    ExpiryMap expiryMap_;
+
+    /* remove request from queue and deadline index */
+    Request remove(ServiceMap::iterator service, RequestSeq::iterator request)
+    {
+        const auto range = expiryMap_.equal_range(request->deadline_);
+        const auto i     = std::find_if(
+            range.first, range.second,
+            [&request](const ExpiryMap::value_type &pair) {
+                return request == pair.second.request_;
+            });
+
+        ASSERT(range.second != i);
+        expiryMap_.erase(i);
+
+        auto r = std::move(*request);
+
+        service->second.erase(request);
+        if (service->second.empty()) serviceMap_.erase(service);
+        return r;
+    }
+public:
+    explicit RequestQueue(Config config)
+        : config_{config}
+    {
+        ENSURE(0 < config_.deadline.count(), RuntimeError);
+        ENSURE(
+            Overflow::begin <= config_.overflow
+                && Overflow::end > config_.overflow,
+            RuntimeError);
+    }
+
+    RequestQueue(const RequestQueue &)            = delete;
+    RequestQueue &operator=(const RequestQueue &) = delete;
+
+    const Config &config() const { return config_; }
+    bool enabled() const { return 0 < config_.depth; }
+
+    size_t size(const ServiceName &serviceName) const
+    {
+        const auto i = serviceMap_.find(serviceName);
+        return std::end(serviceMap_) == i ? 0 : i->second.size();
+    }
+
+    bool empty(const ServiceName &serviceName) const
+    {
+        return 0 == size(serviceName);
+    }
+
+    bool full(const ServiceName &serviceName) const
+    {
+        return config_.depth <= size(serviceName);
+    }
+
+    /* nearest deadline of all queued requests */
+    std::optional<TimePoint> deadline() const
+    {
+        if (expiryMap_.empty()) return std::nullopt;
+        return std::begin(expiryMap_)->first;
+    }
+
+    void push(
+        const ServiceName &serviceName,
+        MDP::ClientAddress clientAddress,
+        MDP::MessageHandle handle,
+        TimePoint clientDeadline = TimePoint::max())
+    {
+        ENSURE(enabled(), FlowError);
+        ENSURE(!full(serviceName), FlowError);
+
+        const auto deadline
+            = std::min(Clock::now() + config_.deadline, clientDeadline);
+        auto service = serviceMap_.emplace(serviceName, RequestSeq{}).first;
+        auto request = service->second.emplace(
+            std::end(service->second), std::move(clientAddress),
+            std::move(handle), deadline, clientDeadline);
+
+        expiryMap_.emplace(deadline, Expiry{service, request});
+    }
+
+    /* oldest queued request of service (next to pop) */
+    const Request &front(const ServiceName &serviceName) const
+    {
+        ENSURE(!empty(serviceName), FlowError);
+        return serviceMap_.find(serviceName)->second.front();
+    }
+
+    Request pop(const ServiceName &serviceName)
+    {
+        ENSURE(!empty(serviceName), FlowError);
+
+        auto i = serviceMap_.find(serviceName);
+
+        return remove(i, std::begin(i->second));
+    }
+
+    /* remove all requests which waited past deadline, f(serviceName, request)
+     * is called for every removed request */
+    template <typename F>
+    void expire(TimePoint now, F f)
+    {
+        while (!expiryMap_.empty() && now >= std::begin(expiryMap_)->first)
+        {
+            const auto expiry = std::begin(expiryMap_)->second;
+            const auto name   = expiry.service_->first;
+
+            f(name, remove(expiry.service_, expiry.request_));
+        }
+    }
+};
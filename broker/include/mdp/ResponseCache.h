@@ -0,0 +1,150 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ensure/Ensure.h"
+#include "mdp/Except.h"
+#include "mdp/MDP.h"
+
+/* bounded (entries, bytes, TTL) LRU cache of reply bodies of single idempotent
+ * service, keyed by request body
+ *
+ * Key is request body serialized with frame sizes (hashed by lookup, full
+ * key is compared - hash collision never returns reply of other request). */
+struct ResponseCache
+{
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+    using Key       = std::string;
+    using Payload   = std::vector<std::string>;
+
+    struct Config
+    {
+        /* max number of cached replies */
+        size_t capacity{1024};
+        /* max total size of keys and reply bodies (reply larger than that
+         * is not cached) */
+        size_t bytes{16 << 20};
+        /* reply is served from cache for ttl since it was cached */
+        std::chrono::milliseconds ttl{std::chrono::seconds{1}};
+    };
+private:
+    struct Entry
+    {
+        Key key_;
+        Payload payload_;
+        TimePoint expires_;
+        size_t bytes_;
+    };
+
+    /* most recently used first */
+    using EntrySeq = std::list<Entry>;
+    /* keys refer to Entry::key_ (list nodes are stable) */
+    using KeyMap = std::unordered_map<std::string_view, EntrySeq::iterator>;
+
+    Config config_;
+    EntrySeq entrySeq_;
+    KeyMap keyMap_;
+    size_t bytes_{0};
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+
+    void erase(KeyMap::iterator i)
+    {
+        const auto entry = i->second;
+
+        bytes_ -= entry->bytes_;
+        keyMap_.erase(i);
+        entrySeq_.erase(entry);
+    }
+
+    static size_t bytes(const Key &key, const Payload &payload)
+    {
+        auto bytes = key.size();
+
+        for (const auto &frame : payload) bytes += frame.size();
+        return bytes;
+    }
+public:
+    explicit ResponseCache(Config config)
+        : config_{config}
+    {
+        ENSURE(0 < config_.capacity, RuntimeError);
+        ENSURE(0 < config_.bytes, RuntimeError);
+        ENSURE(0 < config_.ttl.count(), RuntimeError);
+    }
+
+    ResponseCache(const ResponseCache &)            = delete;
+    ResponseCache &operator=(const ResponseCache &) = delete;
+
+    const Config &config() const { return config_; }
+    size_t size() const { return keyMap_.size(); }
+    size_t bytes() const { return bytes_; }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+    /* frames [first, parts) of message */
+    static Key key(const MDP::Message &msg, size_t first)
+    {
+        Key key = std::to_string(msg.parts() - first) + ';';
+
+        for (auto i = first; i < msg.parts(); ++i)
+        {
+            const auto size = msg.size(i);
+
+            key += std::to_string(size) + ':';
+            key.append(static_cast<const char *>(msg.raw_data(i)), size);
+        }
+        return key;
+    }
+
+    /* nullptr (miss) if not cached or expired, pointer is valid until next
+     * insert */
+    const Payload *find(const Key &key, TimePoint now)
+    {
+        const auto i = keyMap_.find(key);
+
+        if (std::end(keyMap_) == i)
+        {
+            ++misses_;
+            return nullptr;
+        }
+
+        if (now >= i->second->expires_)
+        {
+            erase(i);
+            ++misses_;
+            return nullptr;
+        }
+
+        entrySeq_.splice(std::begin(entrySeq_), entrySeq_, i->second);
+        ++hits_;
+        return &i->second->payload_;
+    }
+
+    /* replaces entry of same key, evicts least recently used until new
+     * entry fits */
+    void insert(Key key, Payload payload, TimePoint now)
+    {
+        const auto i     = keyMap_.find(key);
+        const auto bytes = ResponseCache::bytes(key, payload);
+
+        if (std::end(keyMap_) != i) erase(i);
+        if (config_.bytes < bytes) return;
+
+        while (config_.capacity <= keyMap_.size()
+               || config_.bytes - bytes < bytes_)
+            erase(keyMap_.find(entrySeq_.back().key_));
+
+        entrySeq_.push_front(Entry{
+            std::move(key), std::move(payload), now + config_.ttl, bytes});
+        bytes_ += bytes;
+        keyMap_.emplace(entrySeq_.front().key_, std::begin(entrySeq_));
+    }
+};
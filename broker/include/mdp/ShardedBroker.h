@@ -0,0 +1,62 @@
+#pragma once
+
+#include <zmqpp/zmqpp.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mdp/Broker.h"
+#include "mdp/BrokerConfig.h"
+#include "mdp/MDP.h"
+#include "mdp/OutboundQueue.h"
+#include "mdp/ZMQIdentity.h"
+
+/* Front ROUTER thread classifies messages and forwards them (over inproc)
+ * to N Broker shards, each running in its own thread and owning a slice of
+ * services (hash of service name). Workers stick to shard of their service.
+ * Shards reply through front which is the only user of ROUTER socket.
+ * Front never blocks: messages which would block are kept in per peer
+ * outbound queues of shard (or ROUTER) socket. */
+struct ShardedBroker
+{
+    using Message       = MDP::Message;
+    using MessageHandle = MDP::MessageHandle;
+    using Tag           = Broker::Tag;
+
+    ShardedBroker(std::size_t shards, BrokerConfig config = BrokerConfig{});
+    void exec(const std::string &address);
+    /* exec stops shards and returns within poll timeout */
+    void stop();
+private:
+    using ShardIndex = std::size_t;
+    using SocketSeq  = std::vector<std::unique_ptr<zmqpp::socket>>;
+
+    static constexpr std::chrono::milliseconds outboundRetry{10};
+
+    std::atomic<bool> stopped_{false};
+    std::size_t shards_;
+    BrokerConfig config_;
+    /* worker -> shard of service it registered for */
+    std::unordered_map<ZMQIdentity, ShardIndex> workerShard_;
+    /* messages to shard (by sender) and to peers (by receiver) */
+    std::deque<OutboundQueue> shardOutbound_;
+    OutboundQueue routerOutbound_;
+    /* last flush of ROUTER queue sent something */
+    bool routerProgress_{true};
+
+    ShardIndex shardOf(const std::string &serviceName) const;
+    void onMessage(SocketSeq &, zmqpp::socket &router, MessageHandle);
+    void onShardMessage(ShardIndex, zmqpp::socket &router, MessageHandle);
+    void reject(zmqpp::socket &router, const Message &, Tag);
+    static bool post(zmqpp::socket &, OutboundQueue &, Message &);
+    static bool trySend(zmqpp::socket &, Message &);
+    void flush(SocketSeq &, zmqpp::socket &router);
+    std::chrono::milliseconds pollTimeout() const;
+};
@@ -2,19 +2,28 @@
 
 #include <algorithm>
 #include <ctime>
+#include <list>
 #include <map>
 #include <ostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "ensure/Ensure.h"
 #include "ensure/Trace.h"
 #include "mdp/Except.h"
+#include "mdp/MDP.h"
 #include "mdp/MutualHeartbeatMonitor.h"
 #include "mdp/ZMQIdentity.h"
 
 struct WorkerPool
 {
+    struct Worker;
+
+    /* idle workers (of single service, with credit left), least recently
+     * used first */
+    using IdleSeq = std::list<Worker *>;
+
     struct Worker
     {
         enum class State
@@ -32,40 +41,120 @@ struct WorkerPool
             return os;
         }
 
+        /* request dispatched to worker (owned by BrokerTasks) */
+        struct Task
+        {
+            using TimePoint = MutualHeartbeatMonitor::TimePoint;
+
+            /* client of identical request attached while in flight */
+            struct Follower
+            {
+                MDP::ClientAddress clientAddress_;
+                /* its own deadline (TimePoint::max() if none) */
+                TimePoint deadline_;
+            };
+
+            MDP::ClientAddress clientAddress_;
+            TimePoint dispatched_;
+            /* client deadline (TimePoint::max() if none) */
+            TimePoint deadline_;
+            /* client already got timeout (or failure) reply, worker reply
+             * goes to followers only (task is kept until then - it holds
+             * worker credit) */
+            bool expired_{false};
+            /* request body key (empty if service neither caches nor
+             * coalesces) */
+            std::string requestKey_{};
+            /* each gets copy of reply (or failure) */
+            std::vector<Follower> coalesced_{};
+            /* PARTIAL reply forwarded - no new clients are attached and
+             * reply is not cached */
+            bool streamed_{false};
+
+            /* any client still waits for reply */
+            bool waiting() const { return !expired_ || !coalesced_.empty(); }
+
+            /* number of clients waiting for reply */
+            size_t clients() const
+            {
+                return (expired_ ? 0 : 1) + coalesced_.size();
+            }
+
+            /* clients with deadline not later than now are removed (each
+             * keeps its own deadline), f(const ClientAddress &) */
+            template <typename F>
+            void expire(TimePoint now, F f)
+            {
+                if (!expired_ && deadline_ <= now)
+                {
+                    expired_ = true;
+                    f(clientAddress_);
+                }
+
+                const auto i = std::stable_partition(
+                    std::begin(coalesced_), std::end(coalesced_),
+                    [now](const Follower &follower) {
+                        return now < follower.deadline_;
+                    });
+
+                std::for_each(i, std::end(coalesced_), [&f](const Follower &x) {
+                    f(x.clientAddress_);
+                });
+                coalesced_.erase(i, std::end(coalesced_));
+            }
+        };
+
+        using TaskSeq = std::list<Task>;
+
         std::string serviceName_;
         State state_;
         ZMQIdentity identity_;
+        /* credit window - max number of requests in flight (advertised in
+         * READY) */
+        size_t credits_;
+        /* number of credits in use, worker is busy when all are in use */
+        size_t acquired_{0};
+        /* worker accepts CANCEL of expired requests (advertised in READY) */
+        bool cancel_{false};
+        /* worker accepts chunked requests (advertised in READY) */
+        bool chunked_{false};
         MutualHeartbeatMonitor monitor_;
+        /* deadline of worker's live timer (stale timers are ignored) */
+        MutualHeartbeatMonitor::TimePoint timerDeadline_;
+        /* valid only in Idle state */
+        IdleSeq::iterator idleIterator_;
+        TaskSeq taskSeq_;
 
-        Worker(std::string serviceName, ZMQIdentity identity)
+        Worker(std::string serviceName, ZMQIdentity identity, size_t credits)
             : serviceName_{std::move(serviceName)}
             , state_{State::Idle}
             , identity_{std::move(identity)}
+            , credits_{credits}
         { }
 
         friend std::ostream &operator<<(std::ostream &os, const Worker &w)
         {
             os << w.identity_.asString() << ' ' << w.serviceName_ << ' '
-               << w.state_;
+               << w.state_ << ' ' << w.acquired_ << '/' << w.credits_;
             return os;
         }
     };
 
-    using WorkerSeq     = std::list<Worker>;
-    using ServiceName   = std::string;
-    using ServiceMap    = std::map<std::string, WorkerSeq>;
-    using ServiceLookup = std::map<ZMQIdentity, std::string>;
-private:
-    ServiceMap serviceMap_;
-    ServiceLookup serviceLookup_;
+    using WorkerSeq = std::list<Worker>;
 
-    static WorkerSeq::iterator
-    findWorker(WorkerSeq &workerSeq, const ZMQIdentity &identity)
+    struct Service
     {
-        return std::find_if(
-            std::begin(workerSeq), std::end(workerSeq),
-            [&](const Worker &worker) { return worker.identity_ == identity; });
-    }
+        WorkerSeq workerSeq_;
+        IdleSeq idleSeq_;
+    };
+
+    using ServiceName = std::string;
+    using ServiceMap  = std::map<std::string, Service>;
+    /* std::list iterators are stable - index stays valid until remove */
+    using WorkerIndex = std::unordered_map<ZMQIdentity, WorkerSeq::iterator>;
+private:
+    ServiceMap serviceMap_;
+    WorkerIndex workerIndex_;
 public:
     WorkerPool()                              = default;
     WorkerPool(const WorkerPool &)            = delete;
@@ -76,74 +165,130 @@ public:
     {
         for (auto &pair : serviceMap_)
         {
-            for (auto &worker : pair.second)
+            for (auto &worker : pair.second.workerSeq_)
                 f(worker);
         }
     }
 
+    const ServiceMap &serviceMap() const { return serviceMap_; }
+
+    /* nullptr if service has no workers */
+    const Service *findService(const ServiceName &serviceName) const
+    {
+        const auto i = serviceMap_.find(serviceName);
+        return std::end(serviceMap_) == i ? nullptr : &i->second;
+    }
+
     bool valid(const ServiceName &serviceName) const
     {
         return 0 < serviceMap_.count(serviceName)
-            && !serviceMap_.at(serviceName).empty();
+            && !serviceMap_.at(serviceName).workerSeq_.empty();
     }
 
-    Worker *acquire(const ServiceName &serviceName)
+    /* any worker of service accepts chunked requests */
+    bool chunked(const ServiceName &serviceName) const
     {
-        ENSURE(valid(serviceName), ServiceUnsupported);
+        const auto *service = findService(serviceName);
 
-        auto &workerSeq = serviceMap_[serviceName];
+        return nullptr != service
+            && std::any_of(
+                   std::begin(service->workerSeq_),
+                   std::end(service->workerSeq_),
+                   [](const Worker &worker) { return worker.chunked_; });
+    }
 
-        if (Worker::State::Idle != workerSeq.front().state_) return nullptr;
+    /* acquire credit of least recently used idle worker (round robin),
+     * worker becomes busy when all its credits are in use,
+     * chunked - only workers which accept chunked requests are considered,
+     * nullptr if all (such) workers of service are busy */
+    Worker *acquire(const ServiceName &serviceName, bool chunked = false)
+    {
+        ENSURE(valid(serviceName), ServiceUnsupported);
+
+        auto &idleSeq = serviceMap_[serviceName].idleSeq_;
+        auto i        = std::begin(idleSeq);
 
-        /* round robin (if more then 1 worker in sequence) */
-        if (std::end(workerSeq) != std::next(std::begin(workerSeq)))
+        if (chunked)
         {
-            std::rotate(
-                std::begin(workerSeq), std::next(std::begin(workerSeq)),
-                std::end(workerSeq));
+            i = std::find_if(i, std::end(idleSeq), [](const Worker *w) {
+                return w->chunked_;
+            });
         }
 
-        return &workerSeq.back();
+        if (std::end(idleSeq) == i) return nullptr;
+
+        auto *worker = *i;
+
+        idleSeq.erase(i);
+        ++worker->acquired_;
+
+        if (worker->credits_ > worker->acquired_)
+            worker->idleIterator_ = idleSeq.insert(std::end(idleSeq), worker);
+        else worker->state_ = Worker::State::Busy;
+        return worker;
     }
 
-    WorkerSeq::iterator findWorker(const ZMQIdentity &identity)
+    /* return credit (request completed), busy worker becomes idle
+     * (available for acquire) */
+    void release(Worker &worker)
     {
-        ENSURE(0 < serviceLookup_.count(identity), IdentityInvalid);
+        ENSURE(0 < worker.acquired_, FlowError);
+
+        --worker.acquired_;
+
+        if (Worker::State::Idle == worker.state_) return;
 
-        const auto &serviceName = serviceLookup_.find(identity)->second;
-        auto &workerSeq         = serviceMap_[serviceName];
+        auto &idleSeq = serviceMap_[worker.serviceName_].idleSeq_;
+
+        worker.state_        = Worker::State::Idle;
+        worker.idleIterator_ = idleSeq.insert(std::end(idleSeq), &worker);
+    }
 
-        return findWorker(workerSeq, identity);
+    bool contains(const ZMQIdentity &identity) const
+    {
+        return 0 < workerIndex_.count(identity);
     }
 
-    size_t append(const std::string &serviceName, const ZMQIdentity &identity)
+    WorkerSeq::iterator findWorker(const ZMQIdentity &identity)
     {
-        auto &workerSeq = serviceMap_[serviceName];
+        const auto i = workerIndex_.find(identity);
 
-        ENSURE(
-            workerSeq.end() == findWorker(workerSeq, identity),
-            WorkerDuplicate);
+        ENSURE(std::end(workerIndex_) != i, IdentityInvalid);
+        return i->second;
+    }
 
-        workerSeq.emplace_back(serviceName, identity);
+    size_t append(
+        const std::string &serviceName,
+        const ZMQIdentity &identity,
+        size_t credits = 1)
+    {
+        ENSURE(!contains(identity), WorkerDuplicate);
+        ENSURE(0 < credits, RuntimeError);
 
-        ENSURE(0 == serviceLookup_.count(identity), WorkerDuplicate);
+        auto &service   = serviceMap_[serviceName];
+        auto &workerSeq = service.workerSeq_;
+        const auto i    = workerSeq.emplace(
+            std::end(workerSeq), serviceName, identity, credits);
 
-        serviceLookup_[identity] = serviceName;
+        i->idleIterator_
+            = service.idleSeq_.insert(std::end(service.idleSeq_), &*i);
+        workerIndex_.emplace(identity, i);
         return workerSeq.size();
     }
 
     size_t remove(const ZMQIdentity &identity)
     {
-        ENSURE(0 < serviceLookup_.count(identity), IdentityInvalid);
-
-        const auto &serviceName = serviceLookup_.find(identity)->second;
-        auto &workerSeq         = serviceMap_[serviceName];
+        const auto i       = findWorker(identity);
+        const auto service = serviceMap_.find(i->serviceName_);
+        auto &workerSeq    = service->second.workerSeq_;
 
-        workerSeq.erase(findWorker(workerSeq, identity));
+        if (Worker::State::Idle == i->state_)
+            service->second.idleSeq_.erase(i->idleIterator_);
+        workerIndex_.erase(identity);
+        workerSeq.erase(i);
         const auto num = workerSeq.size();
-        if (workerSeq.empty()) serviceMap_.erase(serviceName);
+        if (workerSeq.empty()) serviceMap_.erase(service);
         // WARNING: workerSeq ref invalid
-        serviceLookup_.erase(identity);
         return num;
     }
 
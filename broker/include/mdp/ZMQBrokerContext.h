@@ -9,11 +9,16 @@
 
 struct ZMQBrokerContext
 {
-    zmqpp::context context_;
+    /* empty if context is shared (broker shard) */
+    std::unique_ptr<zmqpp::context> contextHandle_;
     zmqpp::socket socket_;
     zmqpp::poller poller_;
     ZMQIdentity identity_;
     std::string address_;
 
+    /* ROUTER socket bound to address (own context) */
     ZMQBrokerContext(ZMQIdentity identity, std::string address);
+    /* DEALER socket connected to address (ShardedBroker front) */
+    ZMQBrokerContext(
+        zmqpp::context &, ZMQIdentity identity, std::string address);
 };
@@ -1,42 +1,107 @@
+#include <algorithm>
+#include <cerrno>
+#include <set>
+#include <sstream>
+
 #include "mdp/Broker.h"
 #include "ensure/Trace.h"
 #include "mdp/Except.h"
+#include "mdp/FastTrace.h"
 #include "mdp/MDP.h"
 #include "mdp/ZMQIdentity.h"
 #include "mdp/utils.h"
 
-Broker::Broker(std::chrono::milliseconds timeout)
-    : timeout_{timeout}
-{ }
+const Broker::MMIEntry Broker::mmiTable[] = {
+    {Broker::mmiService, &Broker::onMMIService},
+    {Broker::mmiWorkers, &Broker::onMMIWorkers},
+    {Broker::mmiStats, &Broker::onMMIStats},
+    {Broker::mmiMetrics, &Broker::onMMIMetrics},
+};
+
+Broker::Broker(BrokerConfig config)
+    : timeout_{config.timeout}
+    , batch_{config.batch}
+    , heartbeat_{config.heartbeat}
+    , serviceHeartbeat_{config.serviceHeartbeat}
+    , minHeartbeat_{config.minHeartbeat}
+    , maxHeartbeat_{config.maxHeartbeat}
+    , requestQueue_{config.requestQueue}
+    , outbound_{config.outbound}
+{
+    ENSURE(0 < batch_, RuntimeError);
+    ENSURE(0 < heartbeat_.period.count(), RuntimeError);
+    ENSURE(0 < heartbeat_.liveness, RuntimeError);
+    ENSURE(0 < minHeartbeat_.period.count(), RuntimeError);
+    ENSURE(0 < minHeartbeat_.liveness, RuntimeError);
+    ENSURE(minHeartbeat_.period <= maxHeartbeat_.period, RuntimeError);
+    ENSURE(minHeartbeat_.liveness <= maxHeartbeat_.liveness, RuntimeError);
+
+    for (const auto &pair : config.serviceCache)
+    {
+        cacheMap_.try_emplace(pair.first, pair.second);
+        TRACE(
+            TraceLevel::Info, "cache ", pair.first, " capacity ",
+            pair.second.capacity, " bytes ", pair.second.bytes, " ttl ",
+            pair.second.ttl.count(), "ms");
+    }
+    for (const auto &serviceName : config.serviceCoalesce)
+    {
+        flightMap_[serviceName];
+        TRACE(TraceLevel::Info, "coalesce ", serviceName);
+    }
+    TRACE(
+        TraceLevel::Info, "request queue depth ", config.requestQueue.depth,
+        " deadline ", config.requestQueue.deadline.count(), "ms overflow ",
+        config.requestQueue.overflow);
+}
 
 void Broker::exec(const std::string &address)
 {
-    for (;;)
+    exec([&address]() {
+        return std::make_unique<ZMQContext>(ZMQIdentity::unique(), address);
+    });
+}
+
+void Broker::exec(zmqpp::context &context, const std::string &address)
+{
+    exec([&context, &address]() {
+        return std::make_unique<ZMQContext>(
+            context, ZMQIdentity::unique(), address);
+    });
+}
+
+void Broker::stop()
+{
+    stopped_ = true;
+}
+
+void Broker::exec(const std::function<ZMQContextHandle()> &makeContext)
+{
+    while (!stopped_)
     {
-        zmqContextHandle_
-            = std::make_unique<ZMQContext>(ZMQIdentity::unique(), address);
+        zmqContextHandle_ = makeContext();
+        pollOut_          = false;
         TRACE(
             TraceLevel::Info, zmqContextHandle_->address_, ' ',
             zmqContextHandle_->identity_.asString());
 
         try
         {
-            for (;;)
+            while (!stopped_)
             {
-                if (zmqContextHandle_->poller_.poll(timeout_.count()))
-                {
-                    if (zmqContextHandle_->poller_.has_input(
-                            zmqContextHandle_->socket_))
-                    {
-                        auto message = recv(
-                            zmqContextHandle_->socket_, IOMode::NonBlockig);
+                /* wait for writable socket only if last flush made progress
+                 * (ROUTER is writable if any peer is, not the blocked one) */
+                pollOut(!outbound_.empty() && outboundProgress_);
 
-                        if (message) onMessage(std::move(message));
-                    }
+                if (zmqContextHandle_->poller_.poll(pollTimeout().count())
+                    && zmqContextHandle_->poller_.has_input(
+                        zmqContextHandle_->socket_))
+                {
+                    drain();
                 }
 
+                flush();
                 checkExpired();
-                sendHeartbeatIfNeeded();
             }
         }
         catch (const std::exception &except)
@@ -51,155 +116,599 @@ void Broker::exec(const std::string &address)
     }
 }
 
-void Broker::onMessage(MessageHandle handle)
+void Broker::drain()
 {
-    ASSERT(handle);
+    /* receive until EAGAIN (one poll per batch instead of per message),
+     * bounded so that timers are not starved under sustained load */
+    for (size_t i = 0; i < batch_; ++i)
+    {
+        auto message = recv(zmqContextHandle_->socket_, IOMode::NonBlockig);
 
+        if (!message) return;
+        onMessage(std::move(message));
+    }
+}
+
+auto Broker::classify(const Message &message) -> Tag
+{
     try
     {
         /* at least 3 frames are required to deduce message type */
-        ENSURE(3 <= handle->parts(), MessageFormatInvalid);
+        ENSURE(3 <= message.parts(), MessageFormatInvalid);
         /* Frame 0: identity */
-        ENSURE(0 != handle->size(0), IdentityInvalid);
-        /* Frame 1: empty */
-        ENSURE(0 == handle->size(1), MessageFormatInvalid);
-        /* Frame 2: six byte signature */
-        ENSURE(6 == handle->size(2), MessageFormatInvalid);
+        ENSURE(0 != message.size(0), IdentityInvalid);
     }
     catch (const EnsureException &except)
     {
         TRACE(TraceLevel::Warning, except.invariant);
-        dispatch(Tagged<Tag::Unsupported>{std::move(handle)});
-        return;
+        return Tag::Unsupported;
     }
 
-    if (MDP::Client::Signature::self == handle->get(2))
+    /* client request id (optional) precedes empty frame */
+    const auto n = MDP::Broker::clientFrames(message);
+
+    /* Frame 1: empty, Frame 2: six byte signature */
+    if (n + 2 > message.parts()) return Tag::Unsupported;
+    if (0 != message.size(n) || 6 != message.size(n + 1))
+        return Tag::Unsupported;
+
+    const auto signature = message.get(n + 1);
+
+    if (MDP::Client::Signature::self == signature
+        || MDP::Client::Signature::deadline == signature)
     {
-        onClientMessage(std::move(handle));
+        return Tag::ClientRequest;
     }
-    else if (MDP::Worker::Signature::self == handle->get(2))
+    if (MDP::Client::Signature::chunk == signature) return Tag::ClientChunk;
+    if (MDP::Worker::Signature::self != signature || 1 != n)
+        return Tag::Unsupported;
+    if (4 > message.parts()) return Tag::Unsupported;
+
+    // 0 - identity, 1 - empty frame, 2 - "MDPW01", 3 - command
+    const auto command = message.get(3);
+
+    if (MDP::Worker::Signature::ready == command) return Tag::WorkerReady;
+    if (MDP::Worker::Signature::reply == command) return Tag::WorkerReply;
+    if (MDP::Worker::Signature::partial == command) return Tag::WorkerPartial;
+    if (MDP::Worker::Signature::accept == command) return Tag::WorkerAccept;
+    if (MDP::Worker::Signature::failure == command) return Tag::WorkerFailure;
+    if (MDP::Worker::Signature::heartbeat == command)
+        return Tag::WorkerHeartbeat;
+    if (MDP::Worker::Signature::disconnect == command)
+        return Tag::WorkerDisconnect;
+    return Tag::Unsupported;
+}
+
+void Broker::onMessage(MessageHandle handle)
+{
+    ASSERT(handle);
+
+    switch (classify(*handle))
     {
-        onWorkerMessage(std::move(handle));
+    case Tag::ClientRequest: onClientMessage(std::move(handle)); break;
+    case Tag::ClientChunk:
+        dispatch(Tagged<Tag::ClientChunk>{std::move(handle)});
+        break;
+    case Tag::WorkerReady:
+        dispatch(Tagged<Tag::WorkerReady>{std::move(handle)});
+        break;
+    case Tag::WorkerReply:
+        dispatch(Tagged<Tag::WorkerReply>{std::move(handle)});
+        break;
+    case Tag::WorkerPartial:
+        dispatch(Tagged<Tag::WorkerPartial>{std::move(handle)});
+        break;
+    case Tag::WorkerAccept:
+        dispatch(Tagged<Tag::WorkerAccept>{std::move(handle)});
+        break;
+    case Tag::WorkerFailure:
+        dispatch(Tagged<Tag::WorkerFailure>{std::move(handle)});
+        break;
+    case Tag::WorkerHeartbeat:
+        dispatch(Tagged<Tag::WorkerHeartbeat>{std::move(handle)});
+        break;
+    case Tag::WorkerDisconnect:
+        dispatch(Tagged<Tag::WorkerDisconnect>{std::move(handle)});
+        break;
+    default: dispatch(Tagged<Tag::Unsupported>{std::move(handle)}); break;
     }
-    else { ENSURE(false && "invalid signature", MessageFormatInvalid); }
 }
 
 void Broker::onClientMessage(MessageHandle handle)
 {
     ASSERT(handle);
-    dispatch(Tagged<Tag::ClientRequest>(std::move(handle)));
+
+    /* optional deadline frame is consumed here (relative to receipt) */
+    const auto timeout = MDP::Broker::takeDeadline(*handle);
+    /* Frame n: service name */
+    const auto n = MDP::Broker::clientFrames(*handle) + 2;
+
+    if (n < handle->parts() && 0 == handle->get(n).rfind(mmiPrefix, 0))
+    {
+        dispatch(Tagged<Tag::MMIRequest>(std::move(handle)));
+        return;
+    }
+    dispatch(
+        Tagged<Tag::ClientRequest>(std::move(handle)),
+        0 < timeout.count() ? Clock::now() + timeout : TimePoint::max());
 }
 
-void Broker::onWorkerMessage(MessageHandle handle)
+void Broker::dispatch(Tagged<Tag::ClientChunk> tagged)
 {
-    ASSERT(handle);
-    ASSERT(4 <= handle->parts());
+    ASSERT(tagged.handle);
+    FAST_TRACE(Debug, "client chunk", tagged.handle);
 
-    // 0 - identity, 1 - empty frame, 2 - "MDPW01", 3 - signature
-    const auto signature = handle->get(3);
+    const auto clientAddress = MDP::Broker::clientAddress(*tagged.handle);
+    /* Frames: client address, empty, "MDPCU1", service name, chunk number,
+     * flag */
+    const auto n = clientAddress.frames() + 3;
 
-    if (MDP::Worker::Signature::ready == signature)
+    if (n + 2 > tagged.handle->parts())
     {
-        dispatch(Tagged<Tag::WorkerReady>{std::move(handle)});
+        dispatch(Tagged<Tag::Unsupported>{std::move(tagged.handle)});
+        return;
     }
-    else if (MDP::Worker::Signature::reply == signature)
+
+    /* opens request - worker is assigned as to any other request */
+    if ("0" == tagged.handle->get(n))
     {
-        dispatch(Tagged<Tag::WorkerReply>{std::move(handle)});
+        dispatch(
+            Tagged<Tag::ClientRequest>{std::move(tagged.handle)},
+            TimePoint::max());
+        return;
     }
-    else if (MDP::Worker::Signature::heartbeat == signature)
+
+    const auto key = clientAddress.key();
+    const auto i   = chunkedMap_.find(key);
+
+    /* request already failed (client got reply) */
+    if (std::end(chunkedMap_) == i)
     {
-        dispatch(Tagged<Tag::WorkerHeartbeat>{std::move(handle)});
+        FAST_TRACE(Debug, "client chunk discarded", key);
+        return;
     }
-    else if (MDP::Worker::Signature::disconnect == signature)
+
+    auto &worker   = *workerPool_.findWorker(i->second.worker_);
+    auto *taskInfo = brokerTasks_.find(worker.identity_, key);
+    const auto last = MDP::Client::Signature::last == tagged.handle->get(n + 1);
+
+    ASSERT(nullptr != taskInfo);
+
+    /* out of order (or repeated) chunk - worker would read request with
+     * chunk missing */
+    if (std::to_string(i->second.next_) != tagged.handle->get(n)
+        || !last && MDP::Client::Signature::more != tagged.handle->get(n + 1))
     {
-        dispatch(Tagged<Tag::WorkerDisconnect>{std::move(handle)});
+        ++metrics_.service(worker.serviceName_).failures_;
+        TRACE(
+            TraceLevel::Warning, "client ", clientAddress.identity_.asString(),
+            " chunk ", tagged.handle->get(n), " expected ", i->second.next_,
+            ", request failed");
+        /* task keeps worker credit until worker replies (FAILURE) */
+        taskInfo->expired_ = true;
+        unchunk(*taskInfo);
+        dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeFailureClientRep(
+            clientAddress, worker.serviceName_,
+            MDP::Broker::Signature::serviceFailure)));
+
+        /* worker abandons request (instead of waiting for chunk timeout) */
+        if (worker.cancel_)
+        {
+            post(MDP::Broker::makeCancel(worker.identity_, key));
+            worker.monitor_.selfHeartbeat();
+        }
+        return;
+    }
+
+    ++i->second.next_;
+    if (last) chunkedMap_.erase(i);
+
+    ++metrics_.service(worker.serviceName_).chunks_;
+    /* forward chunk to worker: only envelope frames are rewritten */
+    MDP::Broker::toWorkerChunk(*tagged.handle, clientAddress, worker.identity_);
+
+    if (!post(std::move(*tagged.handle)))
+    {
+        ++metrics_.service(worker.serviceName_).stalled_;
+        TRACE(
+            TraceLevel::Warning, "worker ", worker.identity_.asString(),
+            " outbound queue full, chunk dropped");
+        /* task keeps worker credit until worker replies (reply discarded) */
+        taskInfo->expired_ = true;
+        unchunk(*taskInfo);
+        dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeFailureClientRep(
+            clientAddress, worker.serviceName_,
+            MDP::Broker::Signature::serviceStalled)));
+        return;
     }
-    else { dispatch(Tagged<Tag::Unsupported>{std::move(handle)}); }
+    worker.monitor_.selfHeartbeat();
 }
 
 void Broker::dispatch(Tagged<Tag::ClientReply> tagged)
 {
-    TRACE(TraceLevel::Debug, "client rep ", tagged.handle);
-    send(
-        zmqContextHandle_->socket_, std::move(*tagged.handle),
-        IOMode::Blocking);
+    FAST_TRACE(Debug, "client rep", tagged.handle);
+
+    /* client does not read its replies - its problem only */
+    if (!post(std::move(*tagged.handle)))
+    {
+        ++metrics_.dropped_;
+        FAST_TRACE(Warning, "client rep dropped, outbound queue full");
+    }
 }
 
-void Broker::dispatch(Tagged<Tag::ClientRequest> tagged)
+void Broker::dispatch(Tagged<Tag::ClientRequest> tagged, TimePoint deadline)
 {
-    TRACE(TraceLevel::Debug, "client req ", tagged.handle);
+    FAST_TRACE(Debug, "client req", tagged.handle);
     ASSERT(3 <= tagged.handle->parts());
 
     using namespace MDP::Broker;
 
-    const ZMQIdentity clientIdentity{tagged.handle->get(0)};
+    const auto clientAddress = MDP::Broker::clientAddress(*tagged.handle);
 
-    if (4 > tagged.handle->parts())
+    /* Frames: client address, empty, "MDPC01", service name */
+    if (clientAddress.frames() + 3 > tagged.handle->parts())
     {
         dispatch(Tagged<Tag::ClientReply>(makeFailureClientRep(
-            clientIdentity, "", Signature::serviceUndefined)));
+            clientAddress, "", Signature::serviceUndefined)));
         return;
     }
 
-    const auto serviceName = tagged.handle->get(3);
+    const auto serviceName = tagged.handle->get(clientAddress.frames() + 2);
 
     if (!workerPool_.valid(serviceName))
     {
+        ++metrics_.unsupported_;
         TRACE(TraceLevel::Warning, "service unsupported ", serviceName);
         dispatch(Tagged<Tag::ClientReply>(makeFailureClientRep(
-            clientIdentity, serviceName, Signature::serviceUnsupported)));
+            clientAddress, serviceName, Signature::serviceUnsupported)));
+        return;
+    }
+
+    auto &metrics = metrics_.service(serviceName);
+    auto key      = requestKey(serviceName, *tagged.handle);
+    auto *cache   = key.empty() ? nullptr : findCache(serviceName);
+
+    ++metrics.requests_;
+
+    if (nullptr != cache)
+    {
+        const auto *payload = cache->find(key, Clock::now());
+
+        if (nullptr != payload)
+        {
+            FAST_TRACE(Debug, "cache hit", serviceName);
+            dispatch(Tagged<Tag::ClientReply>(
+                makeSucessClientRep(clientAddress, serviceName, *payload)));
+            return;
+        }
+    }
+
+    if (coalesce(serviceName, key, clientAddress, deadline))
+    {
+        ++metrics.coalesced_;
+        FAST_TRACE(Debug, "coalesced", serviceName);
+        return;
+    }
+
+    const auto isChunked = chunked(*tagged.handle);
+
+    /* no worker of service would ever take it */
+    if (isChunked && !workerPool_.chunked(serviceName))
+    {
+        ++metrics_.unsupported_;
+        TRACE(TraceLevel::Warning, "chunked unsupported ", serviceName);
+        dispatch(Tagged<Tag::ClientReply>(makeFailureClientRep(
+            clientAddress, serviceName, Signature::serviceUnsupported)));
         return;
     }
 
-    auto *worker = workerPool_.acquire(serviceName);
+    auto *worker = workerPool_.acquire(serviceName, isChunked);
 
-    if (nullptr == worker)
+    if (nullptr != worker)
     {
+        dispatch(std::move(tagged), *worker, deadline, std::move(key));
+        return;
+    }
+
+    if (!requestQueue_.enabled()
+        || RequestQueue::Overflow::BusyReply == requestQueue_.config().overflow
+               && requestQueue_.full(serviceName))
+    {
+        ++metrics.busy_;
         dispatch(Tagged<Tag::ClientReply>(makeFailureClientRep(
-            clientIdentity, serviceName, Signature::serviceBusy)));
+            clientAddress, serviceName, Signature::serviceBusy)));
         return;
     }
 
-    auto request = makeWorkerReq(worker->identity_, clientIdentity);
+    if (requestQueue_.full(serviceName))
+    {
+        if (RequestQueue::Overflow::RejectNewest
+            == requestQueue_.config().overflow)
+        {
+            ++metrics.overloaded_;
+            dispatch(Tagged<Tag::ClientReply>(makeFailureClientRep(
+                clientAddress, serviceName, Signature::serviceOverloaded)));
+            return;
+        }
+
+        ASSERT(
+            RequestQueue::Overflow::DropOldest
+            == requestQueue_.config().overflow);
+
+        const auto oldest = requestQueue_.pop(serviceName);
+
+        ++metrics.overloaded_;
+        TRACE(
+            TraceLevel::Warning, "queue overflow ", serviceName,
+            " dropping client ", oldest.clientAddress_.identity_.asString());
+        dispatch(Tagged<Tag::ClientReply>(makeFailureClientRep(
+            oldest.clientAddress_, serviceName,
+            Signature::serviceOverloaded)));
+    }
+
+    requestQueue_.push(
+        serviceName, clientAddress, std::move(tagged.handle), deadline);
+    FAST_TRACE(
+        Debug, "queued", serviceName, requestQueue_.size(serviceName));
+}
+
+void Broker::dispatch(
+    Tagged<Tag::ClientRequest> tagged,
+    WorkerPool::Worker &worker,
+    TimePoint deadline,
+    std::string requestKey)
+{
+    ASSERT(tagged.handle);
 
-    /* copy client request body (forward body to worker) */
-    for (auto i = 4u; tagged.handle->parts() > i; ++i)
+    auto clientAddress = MDP::Broker::clientAddress(*tagged.handle);
+    /* Frame n: signature, n + 3: flag (chunk 0) */
+    const auto n = clientAddress.frames() + 1;
+
+    if (MDP::Client::Signature::chunk != tagged.handle->get(n))
     {
-        MDP::append(request, tagged.handle->get(i));
+        /* forward body to worker: only envelope frames are rewritten */
+        MDP::Broker::toWorkerReq(
+            *tagged.handle, clientAddress, worker.identity_);
+        dispatch(
+            Tagged<Tag::WorkerRequest>{std::move(tagged.handle)}, worker,
+            std::move(clientAddress), deadline, std::move(requestKey));
+        return;
     }
 
+    /* acquired for chunked request */
+    ASSERT(worker.chunked_);
+
+    const auto more = MDP::Client::Signature::more == tagged.handle->get(n + 3);
+    const auto key  = clientAddress.key();
+
+    ++metrics_.service(worker.serviceName_).chunks_;
+    MDP::Broker::toWorkerChunk(*tagged.handle, clientAddress, worker.identity_);
     dispatch(
-        Tagged<Tag::WorkerRequest>((std::move(request))), *worker,
-        clientIdentity);
+        Tagged<Tag::WorkerRequest>{std::move(tagged.handle)}, worker,
+        std::move(clientAddress), deadline, std::move(requestKey));
+
+    /* next chunks follow worker (unless request failed already) */
+    if (more && nullptr != brokerTasks_.find(worker.identity_, key))
+        chunkedMap_[key] = Upload{worker.identity_, 1};
+}
+
+void Broker::dispatchPending(const std::string &serviceName)
+{
+    while (!requestQueue_.empty(serviceName))
+    {
+        /* chunked request waits for worker which accepts it (requests
+         * behind it wait too - FIFO order is kept) */
+        auto *worker = workerPool_.acquire(
+            serviceName, chunked(*requestQueue_.front(serviceName).handle_));
+
+        if (nullptr == worker) return;
+
+        auto request = requestQueue_.pop(serviceName);
+        auto key     = requestKey(serviceName, *request.handle_);
+
+        FAST_TRACE(
+            Debug, "dequeued", serviceName, requestQueue_.size(serviceName));
+        dispatch(
+            Tagged<Tag::ClientRequest>{std::move(request.handle_)}, *worker,
+            request.clientDeadline_, std::move(key));
+    }
+}
+
+void Broker::dispatch(Tagged<Tag::MMIRequest> tagged)
+{
+    ASSERT(tagged.handle);
+    FAST_TRACE(Debug, "mmi req", tagged.handle);
+
+    const auto clientAddress = MDP::Broker::clientAddress(*tagged.handle);
+    /* Frame n: "mmi." service name, Frame n + 1 (optional): service name */
+    const auto n           = clientAddress.frames() + 2;
+    const auto serviceName = tagged.handle->get(n);
+    const auto name
+        = n + 1 < tagged.handle->parts() ? tagged.handle->get(n + 1) : "";
+    const auto i           = std::find_if(
+        std::begin(mmiTable), std::end(mmiTable),
+        [&serviceName](const MMIEntry &entry) {
+            return serviceName == entry.serviceName_;
+        });
+    const auto body
+        = std::end(mmiTable) == i
+              ? PayloadSeq{MDP::Broker::Signature::mmiNotImplemented}
+              : (this->*i->handler_)(name);
+
+    /* MMI status is carried in body, reply itself always succeeds */
+    dispatch(Tagged<Tag::ClientReply>(
+        MDP::Broker::makeSucessClientRep(clientAddress, serviceName, body)));
+}
+
+auto Broker::onMMIService(const std::string &serviceName) const -> PayloadSeq
+{
+    using namespace MDP::Broker;
+
+    return PayloadSeq{
+        workerPool_.valid(serviceName) ? Signature::mmiFound
+                                       : Signature::mmiNotFound};
+}
+
+auto Broker::onMMIWorkers(const std::string &serviceName) const -> PayloadSeq
+{
+    using namespace MDP::Broker;
+
+    if (!workerPool_.valid(serviceName))
+        return PayloadSeq{Signature::mmiNotFound};
+
+    const auto &service = *workerPool_.findService(serviceName);
+
+    /* number of workers, number of workers with credit left */
+    return PayloadSeq{
+        Signature::mmiFound, std::to_string(service.workerSeq_.size()),
+        std::to_string(service.idleSeq_.size())};
+}
+
+auto Broker::onMMIStats(const std::string &serviceName) const -> PayloadSeq
+{
+    using namespace MDP::Broker;
+
+    PayloadSeq body{Signature::mmiFound};
+
+    if (!serviceName.empty())
+    {
+        if (!workerPool_.valid(serviceName))
+            return PayloadSeq{Signature::mmiNotFound};
+
+        body.push_back(
+            "service=" + serviceName + ' ' + formatStats(serviceName));
+        return body;
+    }
+
+    for (const auto &pair : workerPool_.serviceMap())
+    {
+        if (!workerPool_.valid(pair.first)) continue;
+
+        body.push_back(
+            "service=" + pair.first + ' ' + formatStats(pair.first));
+    }
+    return body;
+}
+
+auto Broker::onMMIMetrics(const std::string &serviceName) const -> PayloadSeq
+{
+    using namespace MDP::Broker;
+
+    PayloadSeq body{Signature::mmiFound};
+
+    if (!serviceName.empty())
+    {
+        if (nullptr == metrics_.findService(serviceName)
+            && !workerPool_.valid(serviceName))
+        {
+            return PayloadSeq{Signature::mmiNotFound};
+        }
+        body.push_back(formatMetrics(serviceName));
+        return body;
+    }
+
+    /* services with workers and services which had requests */
+    std::set<std::string> names;
+
+    for (const auto &pair : workerPool_.serviceMap())
+        if (workerPool_.valid(pair.first)) names.insert(pair.first);
+    for (const auto &pair : metrics_.serviceMap_) names.insert(pair.first);
+    for (const auto &name : names) body.push_back(formatMetrics(name));
+    body.push_back(
+        "unsupported=" + std::to_string(metrics_.unsupported_)
+        + " dropped=" + std::to_string(metrics_.dropped_));
+    return body;
 }
 
 void Broker::dispatch(Tagged<Tag::WorkerReady> tagged)
 {
     ASSERT(tagged.handle);
-    ASSERT(5 == tagged.handle->parts());
+    ASSERT(5 <= tagged.handle->parts());
 
     auto identity          = ZMQIdentity{tagged.handle->get(0)};
     const auto serviceName = tagged.handle->get(4);
-    const auto num         = workerPool_.append(serviceName, identity);
+    const auto credits     = readyCredits(*tagged.handle);
+    const auto num
+        = workerPool_.append(serviceName, identity, credits);
+    auto &worker = *workerPool_.findWorker(identity);
+
+    worker.cancel_ = "1"
+                     == MDP::Broker::readyProperty(
+                         *tagged.handle, MDP::Worker::Property::cancel);
+    worker.chunked_ = "1"
+                      == MDP::Broker::readyProperty(
+                          *tagged.handle, MDP::Worker::Property::chunked);
+
+    const auto heartbeat = readyHeartbeat(serviceName, *tagged.handle);
+
+    worker.monitor_.configure(heartbeat.first.period, heartbeat.first.liveness);
+
+    /* effective heartbeat is sent to worker which announced heartbeat
+     * (plain MDP workers keep MDP default) */
+    if (heartbeat.second)
+    {
+        using namespace MDP::Worker;
+
+        post(MDP::Broker::makeHeartbeat(
+            identity,
+            makeProperty(
+                Property::heartbeat,
+                std::to_string(heartbeat.first.period.count())),
+            makeProperty(
+                Property::liveness, std::to_string(heartbeat.first.liveness))));
+        worker.monitor_.selfHeartbeat();
+    }
+
+    schedule(worker);
     TRACE(
         TraceLevel::Info, "worker ", identity.asString(), " ready ",
-        serviceName, " workers ", num);
+        serviceName, " credits ", credits, " heartbeat ",
+        heartbeat.first.period.count(), "ms x", heartbeat.first.liveness,
+        " workers ", num);
     workerPool_.dumpState(TraceLevel::Debug);
+    dispatchPending(serviceName);
 }
 
 void Broker::dispatch(
     Tagged<Tag::WorkerRequest> tagged,
     WorkerPool::Worker &worker,
-    ZMQIdentity clientIdentity)
+    MDP::ClientAddress clientAddress,
+    TimePoint deadline,
+    std::string requestKey)
 {
-    worker.state_ = WorkerPool::Worker::State::Busy;
+    FAST_TRACE(Debug, "worker req", tagged.handle, worker.acquired_);
+
+    /* worker does not read its requests - fail request instead of queueing
+     * without bound (credit is returned) */
+    if (!post(std::move(*tagged.handle)))
+    {
+        ++metrics_.service(worker.serviceName_).stalled_;
+        TRACE(
+            TraceLevel::Warning, "worker ", worker.identity_.asString(),
+            " outbound queue full");
+        workerPool_.release(worker);
+        dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeFailureClientRep(
+            clientAddress, worker.serviceName_,
+            MDP::Broker::Signature::serviceStalled)));
+        return;
+    }
+
     worker.monitor_.selfHeartbeat();
-    const auto i = workerPool_.findWorker(worker.identity_);
-    brokerTasks_.append(i, clientIdentity);
-    TRACE(TraceLevel::Debug, "req ", tagged.handle, " for worker ", *i);
-    send(
-        zmqContextHandle_->socket_, std::move(*tagged.handle),
-        IOMode::Blocking);
+
+    if (TimePoint::max() != deadline)
+    {
+        schedule(TaskTimer{worker.identity_, clientAddress.key()}, deadline);
+    }
+
+    auto *flights = findFlights(worker.serviceName_);
+
+    /* identical requests arriving from now on are attached to this one */
+    if (nullptr != flights && !requestKey.empty())
+        (*flights)[requestKey] = Flight{worker.identity_, clientAddress.key()};
+
+    brokerTasks_.append(
+        workerPool_.findWorker(worker.identity_), std::move(clientAddress),
+        deadline, std::move(requestKey));
 }
 
 void Broker::dispatch(Tagged<Tag::WorkerReply> tagged)
@@ -208,27 +717,209 @@ void Broker::dispatch(Tagged<Tag::WorkerReply> tagged)
     ASSERT(6 <= tagged.handle->parts());
 
     const auto workerIdentity = ZMQIdentity{tagged.handle->get(0)};
-    const auto clientIdentity = ZMQIdentity{tagged.handle->get(4)};
-    const auto &taskInfo      = brokerTasks_.taskInfo(workerIdentity);
-    const auto workerIterator = taskInfo.workerIterator_;
+    const auto workerIterator = workerPool_.findWorker(workerIdentity);
+    /* Frame 4: client address (key) */
+    auto taskInfo = brokerTasks_.remove(workerIdentity, tagged.handle->get(4));
 
-    TRACE(
-        TraceLevel::Debug, "rep from worker ", *workerIterator, " for client ",
-        clientIdentity.asString());
+    FAST_TRACE(
+        Debug, "worker rep", workerIdentity, taskInfo.clientAddress_.identity_);
+
+    workerIterator->monitor_.peerHeartbeat();
+    land(workerIterator->serviceName_, taskInfo);
+
+    /* every client already got timeout reply */
+    if (!taskInfo.waiting())
+    {
+        FAST_TRACE(Debug, "late worker rep discarded", workerIdentity);
+        workerPool_.release(*workerIterator);
+        dispatchPending(workerIterator->serviceName_);
+        return;
+    }
+
+    /* worker may reply before last chunk - rest is discarded */
+    unchunk(taskInfo);
 
-    auto reply = MDP::Broker::makeSucessClientRep(
-        clientIdentity, workerIterator->serviceName_);
+    auto &metrics = metrics_.service(workerIterator->serviceName_);
 
-    /* copy worker reply body (forward body to worker) */
-    for (auto i = 6u; tagged.handle->parts() > i; ++i)
+    /* followers are replied too */
+    metrics.replies_ += taskInfo.clients();
+    metrics.latency_.record(
+        std::chrono::duration_cast<LatencyHistogram::Duration>(
+            Clock::now() - taskInfo.dispatched_));
+
+    /* parts of streamed reply (or chunked request) were not cached */
+    auto *cache = taskInfo.streamed_ || taskInfo.requestKey_.empty()
+                    ? nullptr
+                    : findCache(workerIterator->serviceName_);
+
+    if (nullptr != cache || !taskInfo.coalesced_.empty())
+    {
+        /* Frames 6+: reply body */
+        ResponseCache::Payload payload;
+
+        for (auto i = 6u; i < tagged.handle->parts(); ++i)
+            payload.push_back(tagged.handle->get(i));
+
+        for (const auto &follower : taskInfo.coalesced_)
+        {
+            dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeSucessClientRep(
+                follower.clientAddress_, workerIterator->serviceName_,
+                payload)));
+        }
+
+        if (nullptr != cache)
+        {
+            cache->insert(
+                std::move(taskInfo.requestKey_), std::move(payload),
+                Clock::now());
+        }
+    }
+
+    /* forward body to client: only envelope frames are rewritten */
+    if (!taskInfo.expired_)
     {
-        MDP::append(reply, tagged.handle->get(i));
+        MDP::Broker::toSucessClientRep(
+            *tagged.handle, taskInfo.clientAddress_,
+            workerIterator->serviceName_);
+        dispatch(Tagged<Tag::ClientReply>{std::move(tagged.handle)});
     }
+    workerPool_.release(*workerIterator);
+    dispatchPending(workerIterator->serviceName_);
+}
 
-    dispatch(Tagged<Tag::ClientReply>{std::move(reply)});
+void Broker::dispatch(Tagged<Tag::WorkerPartial> tagged)
+{
+    ASSERT(tagged.handle);
+    ASSERT(6 <= tagged.handle->parts());
+
+    const auto workerIdentity = ZMQIdentity{tagged.handle->get(0)};
+    const auto workerIterator = workerPool_.findWorker(workerIdentity);
+    /* Frame 4: client address (key) */
+    const auto key = tagged.handle->get(4);
+    auto *taskInfo = brokerTasks_.find(workerIdentity, key);
+
+    FAST_TRACE(Debug, "worker partial", workerIdentity);
+    workerIterator->monitor_.peerHeartbeat();
+
+    /* every client already got timeout reply - stream continues until
+     * REPLY returns credit */
+    if (nullptr == taskInfo || !taskInfo->waiting())
+    {
+        FAST_TRACE(Debug, "worker partial discarded", workerIdentity);
+        return;
+    }
+
+    const auto &serviceName = workerIterator->serviceName_;
+
+    taskInfo->streamed_ = true;
+
+    /* part could not be queued (client outbound queue full) - client gets
+     * failure instead of reply with missing part */
+    const auto stalled = [this, &serviceName](const MDP::ClientAddress &c) {
+        ++metrics_.dropped_;
+        ++metrics_.service(serviceName).stalled_;
+        TRACE(
+            TraceLevel::Warning, "client ", c.identity_.asString(),
+            " outbound queue full, streamed reply failed");
+        dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeFailureClientRep(
+            c, serviceName, MDP::Broker::Signature::serviceStalled)));
+    };
+
+    if (!taskInfo->coalesced_.empty())
+    {
+        /* Frames 6+: reply body part */
+        PayloadSeq payload;
+
+        for (auto i = 6u; i < tagged.handle->parts(); ++i)
+            payload.push_back(tagged.handle->get(i));
+
+        auto &followers = taskInfo->coalesced_;
+
+        followers.erase(
+            std::remove_if(
+                std::begin(followers), std::end(followers),
+                [&](const WorkerPool::Worker::Task::Follower &follower) {
+                    if (post(MDP::Broker::makePartialClientRep(
+                            follower.clientAddress_, serviceName, payload)))
+                    {
+                        return false;
+                    }
+                    stalled(follower.clientAddress_);
+                    return true;
+                }),
+            std::end(followers));
+    }
+
+    if (!taskInfo->expired_)
+    {
+        /* forwarded as it arrives: only envelope frames are rewritten */
+        MDP::Broker::toPartialClientRep(
+            *tagged.handle, taskInfo->clientAddress_, serviceName);
+
+        if (!post(std::move(*tagged.handle)))
+        {
+            taskInfo->expired_ = true;
+            stalled(taskInfo->clientAddress_);
+        }
+    }
+
+    /* task keeps worker credit until worker replies (reply discarded) */
+    if (taskInfo->waiting()) return;
+
+    land(serviceName, *taskInfo);
+    unchunk(*taskInfo);
+
+    /* worker stops streaming */
+    if (workerIterator->cancel_)
+    {
+        post(MDP::Broker::makeCancel(workerIdentity, key));
+        workerIterator->monitor_.selfHeartbeat();
+    }
+}
+
+void Broker::dispatch(Tagged<Tag::WorkerAccept> tagged)
+{
+    ASSERT(tagged.handle);
+    ASSERT(5 <= tagged.handle->parts());
+
+    const auto workerIdentity = ZMQIdentity{tagged.handle->get(0)};
+    const auto workerIterator = workerPool_.findWorker(workerIdentity);
+    /* Frame 4: client address (key) */
+    const auto *taskInfo
+        = brokerTasks_.find(workerIdentity, tagged.handle->get(4));
+
+    FAST_TRACE(Debug, "worker accept", workerIdentity);
     workerIterator->monitor_.peerHeartbeat();
-    workerIterator->state_ = WorkerPool::Worker::State::Idle;
-    brokerTasks_.remove(workerIdentity);
+
+    /* client already got failure reply */
+    if (nullptr == taskInfo || taskInfo->expired_) return;
+
+    /* client may send next chunk */
+    dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeAcceptedClientRep(
+        taskInfo->clientAddress_, workerIterator->serviceName_)));
+}
+
+void Broker::dispatch(Tagged<Tag::WorkerFailure> tagged)
+{
+    ASSERT(tagged.handle);
+    ASSERT(5 <= tagged.handle->parts());
+
+    const auto workerIdentity = ZMQIdentity{tagged.handle->get(0)};
+    const auto workerIterator = workerPool_.findWorker(workerIdentity);
+    BrokerTasks::TaskSeq taskSeq;
+
+    /* Frame 4: client address (key) */
+    taskSeq.push_back(
+        brokerTasks_.remove(workerIdentity, tagged.handle->get(4)));
+
+    TRACE(
+        TraceLevel::Warning, "worker ", workerIdentity.asString(), ' ',
+        workerIterator->serviceName_, " request failed");
+    workerIterator->monitor_.peerHeartbeat();
+    /* clients which did not get timeout (or failure) reply yet */
+    onTasksFailed(workerIterator->serviceName_, std::move(taskSeq));
+    workerPool_.release(*workerIterator);
+    dispatchPending(workerIterator->serviceName_);
 }
 
 void Broker::dispatch(Tagged<Tag::WorkerHeartbeat> tagged)
@@ -239,7 +930,7 @@ void Broker::dispatch(Tagged<Tag::WorkerHeartbeat> tagged)
     const auto identity = ZMQIdentity{tagged.handle->get(0)};
     const auto i        = workerPool_.findWorker(identity);
 
-    TRACE(TraceLevel::Trace, *i, ' ', i->monitor_, " heartbeat");
+    FAST_TRACE(Trace, "worker heartbeat", identity);
     i->monitor_.peerHeartbeat();
 }
 
@@ -254,43 +945,304 @@ void Broker::dispatch(Tagged<Tag::WorkerDisconnect> tagged)
 
     TRACE(TraceLevel::Info, "disconnecting: ", *i);
 
-    if (brokerTasks_.valid(identity))
-    {
-        const auto &taskInfo = brokerTasks_.taskInfo(identity);
-
-        dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeFailureClientRep(
-            taskInfo.clientIdentity_, i->serviceName_,
-            MDP::Broker::Signature::serviceFailure)));
-        brokerTasks_.remove(identity);
-    }
+    onTasksFailed(serviceName, brokerTasks_.remove(identity));
+    outbound_.remove(identity);
     const auto num = workerPool_.remove(identity);
     TRACE(TraceLevel::Info, serviceName, " workers ", num);
     workerPool_.dumpState(TraceLevel::Info);
 }
 
+std::optional<size_t>
+Broker::readyNumber(const Message &message, const char *key)
+{
+    const auto value = MDP::Broker::readyProperty(message, key);
+
+    if (value.empty()) return std::nullopt;
+
+    /* digits only - no sign, whitespace or trailing garbage */
+    const auto number = parseNumber(value);
+
+    if (!number)
+        TRACE(TraceLevel::Warning, "invalid ", key, ' ', value, " ignored");
+    return number;
+}
+
+bool Broker::chunked(const Message &request)
+{
+    /* Frames: client address, empty, signature */
+    const auto n = MDP::Broker::clientFrames(request) + 1;
+
+    return n < request.parts()
+        && MDP::Client::Signature::chunk == request.get(n);
+}
+
+size_t Broker::readyCredits(const Message &message)
+{
+    auto credits = readyNumber(message, MDP::Worker::Property::credits);
+
+    if (!credits)
+        credits = readyNumber(message, MDP::Worker::Property::slots);
+    if (!credits) return 1;
+    if (0 < *credits && maxCredits >= *credits) return *credits;
+
+    TRACE(TraceLevel::Warning, "invalid credits ", *credits, " using 1");
+    return 1;
+}
+
+auto Broker::readyHeartbeat(
+    const std::string &serviceName, const Message &message) const
+    -> std::pair<HeartbeatConfig, bool>
+{
+    using namespace MDP::Worker;
+
+    const auto i        = serviceHeartbeat_.find(serviceName);
+    const auto period   = readyNumber(message, Property::heartbeat);
+    const auto liveness = readyNumber(message, Property::liveness);
+
+    /* plain MDP worker heartbeats at its own (MDP default) rate and ignores
+     * HEARTBEAT properties - shorter period would expire healthy worker */
+    if (!period && !liveness) return {HeartbeatConfig{}, false};
+
+    auto heartbeat = std::end(serviceHeartbeat_) == i ? heartbeat_ : i->second;
+
+    /* heartbeat=0 - worker takes broker (service) setting */
+    if (period && 0 < *period)
+    {
+        heartbeat.period = std::clamp(
+            std::chrono::milliseconds{*period}, minHeartbeat_.period,
+            maxHeartbeat_.period);
+    }
+    if (liveness)
+    {
+        heartbeat.liveness = std::clamp(
+            *liveness, minHeartbeat_.liveness, maxHeartbeat_.liveness);
+    }
+    return {heartbeat, true};
+}
+
+std::chrono::milliseconds Broker::pollTimeout() const
+{
+    const auto now     = Clock::now();
+    auto timeout       = workerTimers_.timeout(now, timeout_);
+    const auto pending = requestQueue_.deadline();
+
+    timeout = taskTimers_.timeout(now, timeout);
+
+    /* blocked peers are not signalled by poller - retry periodically */
+    if (!outbound_.empty() && !outboundProgress_)
+        timeout = std::min(timeout, outboundRetry);
+
+    if (!pending) return timeout;
+    if (now >= *pending) return std::chrono::milliseconds{0};
+
+    return std::min(
+        timeout,
+        std::chrono::ceil<std::chrono::milliseconds>(*pending - now));
+}
+
+ResponseCache *Broker::findCache(const std::string &serviceName)
+{
+    const auto i = cacheMap_.find(serviceName);
+
+    return std::end(cacheMap_) == i ? nullptr : &i->second;
+}
+
+Broker::FlightMap *Broker::findFlights(const std::string &serviceName)
+{
+    const auto i = flightMap_.find(serviceName);
+
+    return std::end(flightMap_) == i ? nullptr : &i->second;
+}
+
+std::string
+Broker::requestKey(const std::string &serviceName, const Message &request)
+{
+    if (nullptr == findCache(serviceName)
+        && nullptr == findFlights(serviceName))
+    {
+        return std::string{};
+    }
+    /* body of chunked request is not known upfront */
+    if (MDP::Client::Signature::chunk
+        == request.get(MDP::Broker::clientFrames(request) + 1))
+    {
+        return std::string{};
+    }
+
+    /* Frames: client address, empty, "MDPC01", service name, body */
+    return ResponseCache::key(
+        request, MDP::Broker::clientFrames(request) + 3);
+}
+
+bool Broker::coalesce(
+    const std::string &serviceName,
+    const std::string &requestKey,
+    const MDP::ClientAddress &clientAddress,
+    TimePoint deadline)
+{
+    auto *flights = findFlights(serviceName);
+
+    if (nullptr == flights || requestKey.empty()) return false;
+
+    const auto i = flights->find(requestKey);
+
+    if (std::end(*flights) == i) return false;
+
+    auto *taskInfo = brokerTasks_.find(i->second.worker_, i->second.key_);
+
+    /* parts of reply were already forwarded - dispatch on its own */
+    if (nullptr == taskInfo || !taskInfo->waiting() || taskInfo->streamed_)
+        return false;
+
+    /* follower keeps its own deadline (task timer expires clients whose
+     * deadline passed) */
+    if (TimePoint::max() != deadline)
+    {
+        schedule(TaskTimer{i->second.worker_, i->second.key_}, deadline);
+    }
+
+    taskInfo->coalesced_.push_back({clientAddress, deadline});
+    return true;
+}
+
+void Broker::land(
+    const std::string &serviceName, const BrokerTasks::TaskInfo &taskInfo)
+{
+    auto *flights = findFlights(serviceName);
+
+    if (nullptr == flights || taskInfo.requestKey_.empty()) return;
+
+    const auto i = flights->find(taskInfo.requestKey_);
+
+    /* newer identical request may have replaced it */
+    if (std::end(*flights) != i
+        && taskInfo.clientAddress_.key() == i->second.key_)
+    {
+        flights->erase(i);
+    }
+}
+
+void Broker::unchunk(const BrokerTasks::TaskInfo &taskInfo)
+{
+    if (chunkedMap_.empty()) return;
+    chunkedMap_.erase(taskInfo.clientAddress_.key());
+}
+
+void Broker::schedule(WorkerPool::Worker &worker)
+{
+    /* monitor deadlines only move forward (on heartbeat), worker timer is
+     * scheduled for earliest of them and revalidated on expiry */
+    worker.timerDeadline_ = worker.monitor_.deadline();
+    workerTimers_.schedule(worker.timerDeadline_, worker.identity_);
+}
+
+void Broker::schedule(TaskTimer timer, TimePoint deadline)
+{
+    taskTimers_.schedule(deadline, std::move(timer));
+
+    if (taskTimersPurge_ > taskTimers_.size()) return;
+
+    /* timers of tasks replied, removed or with every client expired */
+    const auto num = taskTimers_.purge(
+        [this](const TaskTimer &stale, TimePoint) {
+            const auto *taskInfo = brokerTasks_.find(stale.worker_, stale.key_);
+
+            return nullptr == taskInfo || !taskInfo->waiting();
+        });
+
+    taskTimersPurge_ = std::max(minTaskTimersPurge, 2 * taskTimers_.size());
+    FAST_TRACE(Debug, "task timers purged", num, taskTimers_.size());
+}
+
 void Broker::checkExpired()
 {
-    std::vector<ZMQIdentity> expired;
+    const auto now = Clock::now();
 
-    workerPool_.forEachWorker([this, &expired](WorkerPool::Worker &worker) {
-        if (worker.monitor_.peerHeartbeatExpired())
-        {
-            TRACE(
-                TraceLevel::Warning, worker.identity_.asString(), ' ',
-                worker.serviceName_, ' ', worker.state_,
-                " heartbeat expired, disconnecting");
-            send(
-                zmqContextHandle_->socket_,
-                MDP::Broker::makeDisconnect(worker.identity_),
-                IOMode::NonBlockig);
-
-            expired.push_back(worker.identity_);
-            return;
-        }
+    workerTimers_.expire(
+        now, [this, now](ZMQIdentity identity, TimePoint deadline) {
+            onTimer(std::move(identity), deadline, now);
+        });
+    taskTimers_.expire(now, [this](TaskTimer timer, TimePoint deadline) {
+        onTaskTimer(std::move(timer), deadline);
     });
+    checkPendingExpired(now);
+}
+
+void Broker::onTaskTimer(TaskTimer timer, TimePoint deadline)
+{
+    auto *taskInfo = brokerTasks_.find(timer.worker_, timer.key_);
+
+    /* already replied (or worker removed) */
+    if (nullptr == taskInfo || !taskInfo->waiting()) return;
+
+    auto &worker  = *workerPool_.findWorker(timer.worker_);
+    auto &metrics = metrics_.service(worker.serviceName_);
+
+    /* every client (request and attached ones) has its own deadline, timer
+     * expires all which passed (timer of other task with same key expires
+     * none) */
+    taskInfo->expire(
+        deadline, [this, &worker, &metrics](const MDP::ClientAddress &client) {
+            ++metrics.timeouts_;
+            dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeFailureClientRep(
+                client, worker.serviceName_,
+                MDP::Broker::Signature::serviceTimeout)));
+        });
+
+    /* task keeps worker credit until worker replies */
+    if (taskInfo->waiting()) return;
+
+    FAST_TRACE(Debug, "task expired", timer.worker_, timer.key_);
+    land(worker.serviceName_, *taskInfo);
+    unchunk(*taskInfo);
+
+    /* worker skips request if not yet processed (still replies) */
+    if (worker.cancel_)
+    {
+        post(MDP::Broker::makeCancel(timer.worker_, timer.key_));
+        worker.monitor_.selfHeartbeat();
+    }
+}
+
+void Broker::onTimer(ZMQIdentity identity, TimePoint deadline, TimePoint now)
+{
+    /* worker already removed */
+    if (!workerPool_.contains(identity)) return;
 
-    for (const auto &identity : expired)
+    auto &worker = *workerPool_.findWorker(identity);
+
+    /* stale timer (worker re-registered with same identity) */
+    if (deadline != worker.timerDeadline_) return;
+
+    if (worker.monitor_.peerHeartbeatExpired(now))
+    {
+        TRACE(
+            TraceLevel::Warning, worker.identity_.asString(), ' ',
+            worker.serviceName_, ' ', worker.state_,
+            " heartbeat expired, disconnecting");
         purge(identity);
+        /* after purge (drops messages queued for worker) */
+        post(MDP::Broker::makeDisconnect(identity));
+        return;
+    }
+
+    sendHeartbeatIfNeeded(worker, now);
+    schedule(worker);
+}
+
+void Broker::checkPendingExpired(TimePoint now)
+{
+    requestQueue_.expire(
+        now,
+        [this](const std::string &serviceName, RequestQueue::Request request) {
+            ++metrics_.service(serviceName).timeouts_;
+            TRACE(
+                TraceLevel::Warning, "queued request expired ", serviceName,
+                " client ", request.clientAddress_.identity_.asString());
+            dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeFailureClientRep(
+                request.clientAddress_, serviceName,
+                MDP::Broker::Signature::serviceTimeout)));
+        });
 }
 
 void Broker::purge(ZMQIdentity identity)
@@ -300,32 +1252,148 @@ void Broker::purge(ZMQIdentity identity)
 
     TRACE(TraceLevel::Warning, *i);
 
-    if (brokerTasks_.valid(identity))
-    {
-        const auto &taskInfo = brokerTasks_.taskInfo(identity);
-
-        dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeFailureClientRep(
-            taskInfo.clientIdentity_, i->serviceName_,
-            MDP::Broker::Signature::serviceFailure)));
-        brokerTasks_.remove(identity);
-    }
+    onTasksFailed(serviceName, brokerTasks_.remove(identity));
+    outbound_.remove(identity);
     const auto num = workerPool_.remove(identity);
     TRACE(TraceLevel::Info, serviceName, " workers ", num);
     workerPool_.dumpState(TraceLevel::Info);
 }
 
-void Broker::sendHeartbeatIfNeeded()
+void Broker::onTasksFailed(
+    const std::string &serviceName, BrokerTasks::TaskSeq taskSeq)
 {
-    workerPool_.forEachWorker([this](WorkerPool::Worker &worker) {
-        if (worker.monitor_.shouldHeartbeat())
+    for (const auto &taskInfo : taskSeq)
+    {
+        land(serviceName, taskInfo);
+        unchunk(taskInfo);
+
+        /* client already got timeout reply (followers still wait) */
+        if (!taskInfo.expired_)
         {
-            send(
-                zmqContextHandle_->socket_,
-                MDP::Broker::makeHeartbeat(worker.identity_),
-                IOMode::NonBlockig);
-            worker.monitor_.selfHeartbeat();
+            ++metrics_.service(serviceName).failures_;
+            dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeFailureClientRep(
+                taskInfo.clientAddress_, serviceName,
+                MDP::Broker::Signature::serviceFailure)));
         }
-    });
+
+        for (const auto &follower : taskInfo.coalesced_)
+        {
+            ++metrics_.service(serviceName).failures_;
+            dispatch(Tagged<Tag::ClientReply>(MDP::Broker::makeFailureClientRep(
+                follower.clientAddress_, serviceName,
+                MDP::Broker::Signature::serviceFailure)));
+        }
+    }
+}
+
+std::string Broker::formatStats(const std::string &serviceName) const
+{
+    const auto *service = workerPool_.findService(serviceName);
+    size_t workers      = 0;
+    size_t idle         = 0;
+    size_t inFlight     = 0;
+    std::ostringstream os;
+
+    if (nullptr != service)
+    {
+        workers = service->workerSeq_.size();
+        idle    = service->idleSeq_.size();
+
+        for (const auto &worker : service->workerSeq_)
+            inFlight += worker.acquired_;
+    }
+
+    os << "workers=" << workers << " idle=" << idle
+       << " in_flight=" << inFlight
+       << " queued=" << requestQueue_.size(serviceName);
+    return os.str();
+}
+
+std::string Broker::formatMetrics(const std::string &serviceName) const
+{
+    static const BrokerMetrics::Service none{};
+
+    const auto *metrics = metrics_.findService(serviceName);
+
+    const auto i = cacheMap_.find(serviceName);
+    std::ostringstream os;
+
+    os << BrokerMetrics::format(serviceName, metrics ? *metrics : none) << ' '
+       << formatStats(serviceName);
+
+    if (std::end(cacheMap_) != i)
+    {
+        os << " cache_size=" << i->second.size()
+           << " cache_bytes=" << i->second.bytes()
+           << " cache_hits=" << i->second.hits()
+           << " cache_misses=" << i->second.misses();
+    }
+    return os.str();
+}
+
+void Broker::sendHeartbeatIfNeeded(WorkerPool::Worker &worker, TimePoint now)
+{
+    /* every message sent to worker counts as heartbeat - explicit one only
+     * after whole period without traffic */
+    if (!worker.monitor_.shouldHeartbeat(now)) return;
+
+    ++metrics_.service(worker.serviceName_).heartbeats_;
+    /* dropped if worker outbound queue is full (worker expires) */
+    post(MDP::Broker::makeHeartbeat(worker.identity_));
+    worker.monitor_.selfHeartbeat();
+}
+
+bool Broker::post(Message message)
+{
+    ASSERT(0 < message.parts());
+
+    /* messages to peer with queued messages are queued to keep order */
+    if (outbound_.empty() || !outbound_.queued(ZMQIdentity{message.get(0)}))
+    {
+        if (trySend(message)) return true;
+    }
+
+    const auto peer = ZMQIdentity{message.get(0)};
+
+    FAST_TRACE(Debug, "outbound queued", peer, outbound_.size());
+    return outbound_.push(peer, std::move(message));
+}
+
+bool Broker::trySend(Message &message)
+{
+    try
+    {
+        return ::trySend(zmqContextHandle_->socket_, message);
+    }
+    catch (const zmqpp::zmq_internal_exception &except)
+    {
+        if (EHOSTUNREACH != except.zmq_error()) throw;
+
+        /* peer disconnected - message is discarded */
+        FAST_TRACE(Debug, "peer unreachable", message);
+        return true;
+    }
+}
+
+void Broker::flush()
+{
+    if (outbound_.empty()) return;
+
+    outboundProgress_
+        = 0 < outbound_.drain([this](Message &message) {
+              return trySend(message);
+          });
+}
+
+void Broker::pollOut(bool enabled)
+{
+    if (enabled == pollOut_) return;
+
+    zmqContextHandle_->poller_.check_for(
+        zmqContextHandle_->socket_,
+        zmqpp::poller::poll_in | zmqpp::poller::poll_error
+            | (enabled ? zmqpp::poller::poll_out : zmqpp::poller::poll_none));
+    pollOut_ = enabled;
 }
 
 void Broker::dispatch(Tagged<Tag::Unsupported> tagged)
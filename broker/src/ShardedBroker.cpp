@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cerrno>
+#include <future>
+
+#include "ensure/Trace.h"
+#include "mdp/Except.h"
+#include "mdp/ShardedBroker.h"
+#include "mdp/utils.h"
+
+namespace {
+
+std::string shardAddress(std::size_t no)
+{
+    return "inproc://mdp-broker-shard-" + std::to_string(no);
+}
+
+} // namespace
+
+ShardedBroker::ShardedBroker(std::size_t shards, BrokerConfig config)
+    : shards_{shards}
+    , config_{config}
+    , routerOutbound_{config.outbound}
+{
+    ENSURE(0 < shards_, RuntimeError);
+    ENSURE(0 < config_.batch, RuntimeError);
+
+    for (auto no = 0u; no < shards_; ++no)
+        shardOutbound_.emplace_back(config_.outbound);
+}
+
+auto ShardedBroker::shardOf(const std::string &serviceName) const
+    -> ShardIndex
+{
+    return std::hash<std::string>{}(serviceName) % shards_;
+}
+
+void ShardedBroker::stop()
+{
+    stopped_ = true;
+}
+
+void ShardedBroker::exec(const std::string &address)
+{
+    zmqpp::context context;
+    zmqpp::socket router{context, zmqpp::socket_type::router};
+    zmqpp::poller poller;
+    SocketSeq shardSeq;
+    /* outlive shardTasks (joined on destruction) */
+    std::deque<Broker> brokerSeq;
+    std::vector<std::future<void>> shardTasks;
+
+    /* shards are stopped on any exit (even throw in setup) before
+     * shardTasks wait for them */
+    struct StopGuard
+    {
+        std::deque<Broker> &brokerSeq_;
+
+        ~StopGuard()
+        {
+            for (auto &broker : brokerSeq_) broker.stop();
+        }
+    } stopGuard{brokerSeq};
+
+    ENSURE(context, RuntimeError);
+    ENSURE(!address.empty(), RuntimeError);
+
+    const auto identity = ZMQIdentity::unique();
+
+    router.set(
+        zmqpp::socket_option::identity, identity.data(), identity.size());
+    router.set(zmqpp::socket_option::linger, 0);
+    /* fail (instead of silent drop) on peer high water mark */
+    router.set(zmqpp::socket_option::router_mandatory, true);
+    router.bind(address);
+    poller.add(router, zmqpp::poller::poll_in | zmqpp::poller::poll_error);
+
+    for (auto no = 0u; no < shards_; ++no)
+    {
+        auto socket = std::make_unique<zmqpp::socket>(
+            context, zmqpp::socket_type::dealer);
+
+        socket->set(zmqpp::socket_option::linger, 0);
+        /* inproc: bind has to precede connect (shard) */
+        socket->bind(shardAddress(no));
+        poller.add(*socket, zmqpp::poller::poll_in | zmqpp::poller::poll_error);
+        shardSeq.push_back(std::move(socket));
+
+        auto &broker = brokerSeq.emplace_back(config_);
+
+        shardTasks.push_back(
+            std::async(std::launch::async, [&broker, &context, no]() {
+                broker.exec(context, shardAddress(no));
+            }));
+    }
+
+    TRACE(
+        TraceLevel::Info, address, ' ', identity.asString(), " shards ",
+        shards_);
+
+    const auto pollOut = [&poller](zmqpp::socket &socket, bool enabled) {
+        poller.check_for(
+            socket,
+            zmqpp::poller::poll_in | zmqpp::poller::poll_error
+                | (enabled ? zmqpp::poller::poll_out
+                           : zmqpp::poller::poll_none));
+    };
+
+    while (!stopped_)
+    {
+        try
+        {
+            /* DEALER has single peer (shard) - writable means it is not
+             * blocked, ROUTER is writable if any peer is (see Broker) */
+            for (auto no = 0u; no < shards_; ++no)
+                pollOut(*shardSeq[no], !shardOutbound_[no].empty());
+            pollOut(router, !routerOutbound_.empty() && routerProgress_);
+
+            if (poller.poll(pollTimeout().count()))
+            {
+                /* drain up to batch messages per socket and wakeup */
+                if (poller.has_input(router))
+                {
+                    for (size_t i = 0; i < config_.batch; ++i)
+                    {
+                        auto message = recv(router, IOMode::NonBlockig);
+
+                        if (!message) break;
+                        onMessage(shardSeq, router, std::move(message));
+                    }
+                }
+
+                for (auto no = 0u; no < shards_; ++no)
+                {
+                    auto &socket = *shardSeq[no];
+
+                    if (!poller.has_input(socket)) continue;
+
+                    for (size_t i = 0; i < config_.batch; ++i)
+                    {
+                        auto message = recv(socket, IOMode::NonBlockig);
+
+                        if (!message) break;
+                        onShardMessage(no, router, std::move(message));
+                    }
+                }
+            }
+
+            flush(shardSeq, router);
+        }
+        catch (const std::exception &except)
+        {
+            TRACE(TraceLevel::Error, except.what());
+        }
+    }
+}
+
+void ShardedBroker::onMessage(
+    SocketSeq &shardSeq, zmqpp::socket &router, MessageHandle handle)
+{
+    ASSERT(handle);
+
+    const auto tag = Broker::classify(*handle);
+
+    if (Tag::Unsupported == tag)
+    {
+        TRACE(TraceLevel::Warning, "unsupported message discarded ", handle);
+        return;
+    }
+
+    auto no = ShardIndex{0};
+
+    if (Tag::ClientChunk == tag)
+    {
+        /* Frames: client address, empty, "MDPCU1", service name - every
+         * chunk goes to shard which assigned worker to chunk 0 */
+        const auto n = MDP::Broker::clientFrames(*handle) + 2;
+
+        if (n < handle->parts()) no = shardOf(handle->get(n));
+    }
+    else if (Tag::ClientRequest == tag)
+    {
+        /* Frames: client address, empty, "MDPC01", service name
+         * (if service name is missing any shard replies with error) */
+        auto n = MDP::Broker::clientFrames(*handle) + 2;
+
+        /* MMI request is answered by shard of service named in body (shard 0
+         * if none), deadline frame precedes body */
+        if (n < handle->parts()
+            && 0 == handle->get(n).rfind(Broker::mmiPrefix, 0))
+        {
+            if (MDP::Client::Signature::deadline == handle->get(n - 1)) ++n;
+            ++n;
+        }
+        if (n < handle->parts()) no = shardOf(handle->get(n));
+    }
+    else if (Tag::WorkerReady == tag)
+    {
+        /* Frame 4: service name */
+        if (5 > handle->parts())
+        {
+            TRACE(TraceLevel::Warning, "invalid ready discarded ", handle);
+            return;
+        }
+
+        const auto identity = ZMQIdentity{handle->get(0)};
+        const auto i        = workerShard_.find(identity);
+
+        no = shardOf(handle->get(4));
+
+        /* worker registers for service of other shard - DISCONNECT (as if
+         * sent by worker) fails its tasks there and drops registration */
+        if (std::end(workerShard_) != i && no != i->second)
+        {
+            TRACE(
+                TraceLevel::Warning, "worker ", identity.asString(),
+                " moved from shard ", i->second, " to ", no);
+            auto disconnect = MDP::Broker::makeDisconnect(identity);
+
+            post(
+                *shardSeq[i->second], shardOutbound_[i->second], disconnect);
+        }
+        workerShard_[identity] = no;
+    }
+    else
+    {
+        const auto identity = ZMQIdentity{handle->get(0)};
+        const auto i        = workerShard_.find(identity);
+
+        if (std::end(workerShard_) == i)
+        {
+            TRACE(
+                TraceLevel::Warning, "unknown worker ", identity.asString(),
+                " message discarded ", handle);
+            return;
+        }
+
+        no = i->second;
+        if (Tag::WorkerDisconnect == tag) workerShard_.erase(i);
+    }
+
+    if (post(*shardSeq[no], shardOutbound_[no], *handle)) return;
+
+    TRACE(TraceLevel::Warning, "shard ", no, " queue full");
+    reject(router, *handle, tag);
+}
+
+void ShardedBroker::onShardMessage(
+    ShardIndex no, zmqpp::socket &router, MessageHandle handle)
+{
+    ASSERT(handle);
+    ASSERT(4 <= handle->parts());
+
+    /* shard disconnects (expired) worker:
+     * 0 - identity, 1 - empty frame, 2 - "MDPW01", 3 - command */
+    if (MDP::Worker::Signature::self == handle->get(2)
+        && MDP::Worker::Signature::disconnect == handle->get(3))
+    {
+        const auto i = workerShard_.find(ZMQIdentity{handle->get(0)});
+
+        /* worker meanwhile registered at other shard - keep it */
+        if (std::end(workerShard_) != i && no != i->second) return;
+        if (std::end(workerShard_) != i) workerShard_.erase(i);
+    }
+
+    if (post(router, routerOutbound_, *handle)) return;
+
+    TRACE(
+        TraceLevel::Warning, "peer ", ZMQIdentity{handle->get(0)}.asString(),
+        " queue full, message dropped");
+}
+
+void ShardedBroker::reject(
+    zmqpp::socket &router, const Message &message, Tag tag)
+{
+    if (Tag::ClientRequest == tag || Tag::ClientChunk == tag)
+    {
+        const auto n           = MDP::Broker::clientFrames(message) + 2;
+        const auto serviceName = n < message.parts() ? message.get(n) : "";
+
+        auto failure = MDP::Broker::makeFailureClientRep(
+            MDP::Broker::clientAddress(message), serviceName,
+            MDP::Broker::Signature::serviceOverloaded);
+
+        post(router, routerOutbound_, failure);
+        return;
+    }
+
+    /* lost worker message (e.g. REPLY) would leave its credit taken -
+     * worker reconnects, shard expires old registration */
+    const auto identity = ZMQIdentity{message.get(0)};
+    auto disconnect     = MDP::Broker::makeDisconnect(identity);
+
+    workerShard_.erase(identity);
+    post(router, routerOutbound_, disconnect);
+}
+
+bool ShardedBroker::post(
+    zmqpp::socket &socket, OutboundQueue &outbound, Message &message)
+{
+    ASSERT(0 < message.parts());
+
+    const auto peer = ZMQIdentity{message.get(0)};
+
+    /* messages of peer with queued messages are queued to keep order */
+    if (!outbound.queued(peer) && trySend(socket, message)) return true;
+    /* message is left to caller */
+    if (outbound.full(peer)) return false;
+
+    return outbound.push(peer, std::move(message));
+}
+
+bool ShardedBroker::trySend(zmqpp::socket &socket, Message &message)
+{
+    try
+    {
+        return ::trySend(socket, message);
+    }
+    catch (const zmqpp::zmq_internal_exception &except)
+    {
+        if (EHOSTUNREACH != except.zmq_error()) throw;
+
+        /* peer disconnected - message is discarded */
+        return true;
+    }
+}
+
+void ShardedBroker::flush(SocketSeq &shardSeq, zmqpp::socket &router)
+{
+    for (auto no = 0u; no < shards_; ++no)
+    {
+        shardOutbound_[no].drain([&socket = *shardSeq[no]](Message &message) {
+            return trySend(socket, message);
+        });
+    }
+
+    if (routerOutbound_.empty()) return;
+
+    routerProgress_ = 0 < routerOutbound_.drain([&router](Message &message) {
+        return trySend(router, message);
+    });
+}
+
+std::chrono::milliseconds ShardedBroker::pollTimeout() const
+{
+    /* blocked peers are not signalled by poller - retry periodically */
+    if (!routerOutbound_.empty() && !routerProgress_)
+        return std::min(config_.timeout, outboundRetry);
+    return config_.timeout;
+}
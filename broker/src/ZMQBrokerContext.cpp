@@ -2,17 +2,38 @@
 #include "mdp/Except.h"
 
 ZMQBrokerContext::ZMQBrokerContext(ZMQIdentity identity, std::string address)
-    : socket_{context_, zmqpp::socket_type::router}
+    : contextHandle_{std::make_unique<zmqpp::context>()}
+    , socket_{*contextHandle_, zmqpp::socket_type::router}
     , identity_{std::move(identity)}
     , address_{std::move(address)}
 {
-    ENSURE(context_, RuntimeError);
+    ENSURE(*contextHandle_, RuntimeError);
     ENSURE(!address_.empty(), RuntimeError);
 
     socket_.set(
         zmqpp::socket_option::identity, identity_.data(), identity_.size());
     socket_.set(zmqpp::socket_option::linger, 0);
+    /* report peer at high water mark (EAGAIN) or unknown (EHOSTUNREACH)
+     * instead of silently dropping message */
+    socket_.set(zmqpp::socket_option::router_mandatory, true);
 
     socket_.bind(address_);
     poller_.add(socket_, zmqpp::poller::poll_in | zmqpp::poller::poll_error);
 }
+
+ZMQBrokerContext::ZMQBrokerContext(
+    zmqpp::context &context, ZMQIdentity identity, std::string address)
+    : socket_{context, zmqpp::socket_type::dealer}
+    , identity_{std::move(identity)}
+    , address_{std::move(address)}
+{
+    ENSURE(context, RuntimeError);
+    ENSURE(!address_.empty(), RuntimeError);
+
+    socket_.set(
+        zmqpp::socket_option::identity, identity_.data(), identity_.size());
+    socket_.set(zmqpp::socket_option::linger, 0);
+
+    socket_.connect(address_);
+    poller_.add(socket_, zmqpp::poller::poll_in | zmqpp::poller::poll_error);
+}
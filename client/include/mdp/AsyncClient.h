@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "mdp/MDP.h"
+#include "mdp/TimerQueue.h"
+#include "mdp/ZMQAsyncClientContext.h"
+
+/* long lived client: single connection to broker shared by many in-flight
+ * requests, replies are correlated by request id (envelope frame preceding
+ * empty delimiter) and completed from I/O thread
+ *
+ * On failure (timeout, broker failure reply) request completes with empty
+ * PayloadSeq (same as Client::exec). Lost broker connection is not detected
+ * (ZeroMQ reconnects silently) - timeout is mandatory, request to broker
+ * which went away fails when it expires.
+ *
+ * Callbacks run on I/O thread: exec() called from callback is handled
+ * in place (never waits for I/O thread), destroying AsyncClient from
+ * callback is an error (I/O thread would join itself). */
+class AsyncClient
+{
+    using ZMQContext = ZMQAsyncClientContext;
+public:
+    using Message    = MDP::Message;
+    using PayloadSeq = std::vector<std::string>;
+    using Callback   = std::function<void(PayloadSeq)>;
+    /* body of each part of streamed reply (status not included) */
+    using PartialCallback = std::function<void(PayloadSeq)>;
+    using RequestId       = std::string;
+private:
+    struct Pending
+    {
+        Callback callback_;
+        PartialCallback partialCallback_;
+        /* bodies of streamed reply parts (no partialCallback) */
+        PayloadSeq collected_;
+    };
+
+    using PendingMap = std::unordered_map<RequestId, Pending>;
+    using Clock      = TimerQueue<RequestId>::Clock;
+    using TimePoint  = TimerQueue<RequestId>::TimePoint;
+
+    ZMQContext zmqContext_;
+    /* also sent to broker as request deadline */
+    std::chrono::milliseconds timeout_;
+    /* guards pending_, nextId_, running_, ioThread_ and masterSocket_ */
+    std::mutex mutex_;
+    PendingMap pending_;
+    uint64_t nextId_{0};
+    bool running_{true};
+    /* callbacks are called from this thread */
+    std::thread::id ioThread_{};
+    /* accessed only by I/O thread */
+    TimerQueue<RequestId> timers_;
+    std::future<void> io_;
+public:
+    /* timeout - per request, above 0 */
+    AsyncClient(std::string address, std::chrono::milliseconds timeout);
+    ~AsyncClient();
+
+    AsyncClient(const AsyncClient &)            = delete;
+    AsyncClient &operator=(const AsyncClient &) = delete;
+
+    std::future<PayloadSeq>
+    exec(const std::string &serviceName, const PayloadSeq &payload);
+    /* callback (and partialCallback) is called from I/O thread
+     * streamed reply: without partialCallback bodies of all parts are
+     * passed to callback after status (same as Client::exec) */
+    void exec(
+        const std::string &serviceName,
+        const PayloadSeq &payload,
+        Callback callback,
+        PartialCallback partialCallback = {});
+private:
+    void exec();
+    long pollTimeout() const;
+    void onRequest(MDP::MessageHandle);
+    void onReply(MDP::MessageHandle);
+    void onTimeout();
+    void onPartial(const RequestId &, PayloadSeq);
+    void complete(const RequestId &, PayloadSeq);
+    void abort();
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <functional>
+#include <istream>
+
 #include "mdp/MDP.h"
 #include "mdp/ZMQClientContext.h"
 
@@ -9,13 +12,33 @@ class Client
 public:
     using Message    = MDP::Message;
     using PayloadSeq = std::vector<std::string>;
+    /* body of each part of streamed reply (status not included) */
+    using PartialCallback = std::function<void(PayloadSeq)>;
 
+    /* streamed reply: without partialCallback bodies of all parts are
+     * returned after status (in order, followed by last part) */
     PayloadSeq exec(
         const std::string &address,
         const std::string &serviceName,
-        const PayloadSeq &payload);
+        const PayloadSeq &payload,
+        const PartialCallback &partialCallback = {});
+    /* chunked request: payload is read and sent in chunks of chunkSize
+     * bytes (single body frame each), at most MDP::Client::chunkWindow
+     * chunks are in flight - payload is never held in memory as a whole */
+    PayloadSeq upload(
+        const std::string &address,
+        const std::string &serviceName,
+        std::istream &payload,
+        size_t chunkSize                       = size_t{1} << 20,
+        const PartialCallback &partialCallback = {});
 private:
     void onRequest(Message, ZMQContext &);
+    /* reply (or parts of streamed reply) */
+    PayloadSeq collect(
+        PayloadSeq reply,
+        ZMQContext &,
+        const std::string &serviceName,
+        const PartialCallback &);
     Message onMessage(Message, const ZMQContext &, const std::string &);
     PayloadSeq onReply(Message);
 };
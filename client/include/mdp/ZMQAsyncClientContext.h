@@ -0,0 +1,21 @@
+#pragma once
+
+#include <zmqpp/zmqpp.hpp>
+
+#include "mdp/ZMQIdentity.h"
+
+/* socket_      - long lived connection to broker (owned by I/O thread)
+ * masterSocket_ - requests submitted by callers (guarded by AsyncClient)
+ * slaveSocket_  - I/O thread end of master/slave inproc pair */
+struct ZMQAsyncClientContext
+{
+    zmqpp::context context_;
+    zmqpp::socket socket_;
+    zmqpp::socket masterSocket_;
+    zmqpp::socket slaveSocket_;
+    zmqpp::poller poller_;
+    ZMQIdentity identity_;
+    std::string address_;
+
+    ZMQAsyncClientContext(ZMQIdentity identity, std::string address);
+};
@@ -0,0 +1,293 @@
+#include "mdp/AsyncClient.h"
+#include "mdp/Except.h"
+#include "mdp/FastTrace.h"
+#include "mdp/utils.h"
+
+#include <exception>
+
+AsyncClient::AsyncClient(
+    std::string address, std::chrono::milliseconds timeout)
+    : zmqContext_{ZMQIdentity::unique(), std::move(address)}
+    , timeout_{timeout}
+{
+    /* without timeout request to lost broker would never complete */
+    ENSURE(0 < timeout_.count(), RuntimeError);
+
+    io_ = std::async(std::launch::async, [this]() { exec(); });
+}
+
+AsyncClient::~AsyncClient()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        /* I/O thread can not join itself (destructor can not throw) */
+        if (std::this_thread::get_id() == ioThread_)
+        {
+            TRACE(TraceLevel::Error, this, " destroyed from callback");
+            std::terminate();
+        }
+
+        if (running_)
+        {
+            TRACE(TraceLevel::Debug, this, " exit");
+            send(zmqContext_.masterSocket_, Message{"exit"}, IOMode::Blocking);
+        }
+    }
+
+    try
+    {
+        io_.get();
+    }
+    catch (const std::exception &except)
+    {
+        TRACE(TraceLevel::Error, this, " ", except.what());
+    }
+}
+
+auto AsyncClient::exec(
+    const std::string &serviceName,
+    const PayloadSeq &payload) -> std::future<PayloadSeq>
+{
+    auto promise = std::make_shared<std::promise<PayloadSeq>>();
+    auto future  = promise->get_future();
+
+    exec(serviceName, payload, [promise](PayloadSeq reply) {
+        promise->set_value(std::move(reply));
+    });
+    return future;
+}
+
+void AsyncClient::exec(
+    const std::string &serviceName,
+    const PayloadSeq &payload,
+    Callback callback,
+    PartialCallback partialCallback)
+{
+    ASSERT(callback);
+
+    MDP::MessageHandle handle;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        if (running_)
+        {
+            auto requestId = std::to_string(++nextId_);
+            /* timeout is also passed to broker as deadline - broker replies
+             * and stops tracking request on its own */
+            auto request = MDP::Client::makeReqWithDeadline(
+                requestId, serviceName, timeout_, payload);
+
+            FAST_TRACE(Debug, "req", request);
+            pending_.emplace(
+                std::move(requestId),
+                Pending{std::move(callback), std::move(partialCallback), {}});
+
+            /* called from callback - I/O thread does not read master/slave
+             * pair meanwhile (blocking send would never complete once pair
+             * reaches high water mark) */
+            if (std::this_thread::get_id() != ioThread_)
+            {
+                send(
+                    zmqContext_.masterSocket_, std::move(request),
+                    IOMode::Blocking);
+                return;
+            }
+            handle = MDP::makeMessageHandle(std::move(request));
+        }
+    }
+
+    if (handle)
+    {
+        onRequest(std::move(handle));
+        return;
+    }
+
+    TRACE(TraceLevel::Warning, this, " not running, ", serviceName, " failed");
+    callback({});
+}
+
+void AsyncClient::exec()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        ioThread_ = std::this_thread::get_id();
+    }
+
+    try
+    {
+        for (;;)
+        {
+            if (zmqContext_.poller_.poll(pollTimeout()))
+            {
+                if (zmqContext_.poller_.has_input(zmqContext_.socket_))
+                {
+                    auto handle = recv(zmqContext_.socket_, IOMode::NonBlockig);
+
+                    if (handle) onReply(std::move(handle));
+                }
+                if (zmqContext_.poller_.has_input(zmqContext_.slaveSocket_))
+                {
+                    auto handle
+                        = recv(zmqContext_.slaveSocket_, IOMode::NonBlockig);
+
+                    if (handle && 1 == handle->parts()
+                        && "exit" == handle->get(0))
+                        break;
+                    if (handle) onRequest(std::move(handle));
+                }
+            }
+            onTimeout();
+        }
+    }
+    catch (const std::exception &except)
+    {
+        TRACE(TraceLevel::Error, this, " ", except.what(), " aborting");
+        abort();
+        throw;
+    }
+    abort();
+}
+
+long AsyncClient::pollTimeout() const
+{
+    if (timers_.empty()) return zmqpp::poller::wait_forever;
+    return timers_.timeout(Clock::now(), timeout_).count();
+}
+
+void AsyncClient::onRequest(MDP::MessageHandle handle)
+{
+    ASSERT(handle);
+    ASSERT(0 < handle->parts());
+
+    timers_.schedule(Clock::now() + timeout_, handle->get(0));
+    send(zmqContext_.socket_, std::move(*handle), IOMode::Blocking);
+}
+
+void AsyncClient::onReply(MDP::MessageHandle handle)
+{
+    ASSERT(handle);
+    FAST_TRACE(Debug, "rep", handle);
+
+    try
+    {
+        ENSURE(5 <= handle->parts(), MessageFormatInvalid);
+        /* Frame 0: request id */
+        ENSURE(0 < handle->size(0), MessageFormatInvalid);
+        /* Frame 1: empty */
+        ENSURE(0 == handle->size(1), MessageFormatInvalid);
+        /* Frame 2: six byte signature (client) */
+        ENSURE(6 == handle->size(2), MessageFormatInvalid);
+        ENSURE(
+            MDP::Client::Signature::self == handle->get(2),
+            MessageFormatInvalid);
+    }
+    catch (const EnsureException &except)
+    {
+        TRACE(
+            TraceLevel::Warning, this, " unsupported message discarded ",
+            handle);
+        return;
+    }
+
+    /* Frame 3: service name, Frame 4+: status and payload */
+    PayloadSeq seq;
+
+    for (size_t i = 4; i < handle->parts(); ++i) seq.push_back(handle->get(i));
+
+    if (MDP::Broker::Signature::statusPartial == seq.front())
+    {
+        seq.erase(std::begin(seq));
+        onPartial(handle->get(0), std::move(seq));
+    }
+    else { complete(handle->get(0), std::move(seq)); }
+}
+
+void AsyncClient::onPartial(const RequestId &requestId, PayloadSeq seq)
+{
+    Pending *pending = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        auto i = pending_.find(requestId);
+
+        if (std::end(pending_) == i)
+        {
+            FAST_TRACE(Debug, "not pending", requestId);
+            return;
+        }
+        /* only I/O thread erases - element outlives lock */
+        pending = &i->second;
+    }
+
+    if (pending->partialCallback_)
+    {
+        pending->partialCallback_(std::move(seq));
+        return;
+    }
+
+    auto &collected = pending->collected_;
+
+    collected.insert(
+        std::end(collected), std::make_move_iterator(std::begin(seq)),
+        std::make_move_iterator(std::end(seq)));
+}
+
+void AsyncClient::onTimeout()
+{
+    timers_.expire(
+        Clock::now(),
+        [this](RequestId requestId, TimePoint) {
+            /* no-op if reply already received */
+            complete(requestId, {});
+        });
+}
+
+void AsyncClient::complete(const RequestId &requestId, PayloadSeq seq)
+{
+    Callback callback;
+    PayloadSeq collected;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        auto i = pending_.find(requestId);
+
+        if (std::end(pending_) == i)
+        {
+            FAST_TRACE(Debug, "not pending", requestId);
+            return;
+        }
+        callback  = std::move(i->second.callback_);
+        collected = std::move(i->second.collected_);
+        pending_.erase(i);
+    }
+    /* parts of streamed reply follow status (none on failure) */
+    if (!seq.empty())
+    {
+        seq.insert(
+            std::next(std::begin(seq)),
+            std::make_move_iterator(std::begin(collected)),
+            std::make_move_iterator(std::end(collected)));
+    }
+    /* called without lock so callback can issue new requests */
+    callback(std::move(seq));
+}
+
+void AsyncClient::abort()
+{
+    PendingMap pending;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        running_ = false;
+        pending.swap(pending_);
+    }
+
+    for (auto &pair : pending) pair.second.callback_({});
+    timers_.clear();
+}
@@ -1,17 +1,21 @@
 #include "mdp/Client.h"
+#include "mdp/ChunkWindow.h"
 #include "mdp/Except.h"
 
 auto Client::exec(
     const std::string &address,
     const std::string &serviceName,
-    const PayloadSeq &payloadSeq) -> PayloadSeq
+    const PayloadSeq &payloadSeq,
+    const PartialCallback &partialCallback) -> PayloadSeq
 {
     auto zmqContext = ZMQContext{ZMQIdentity::unique(), address};
 
     try
     {
         onRequest(MDP::Client::makeReq(serviceName, payloadSeq), zmqContext);
-        return onReply(onMessage(zmqContext.recv(), zmqContext, serviceName));
+        return collect(
+            onReply(onMessage(zmqContext.recv(), zmqContext, serviceName)),
+            zmqContext, serviceName, partialCallback);
     }
     catch (const std::exception &except)
     {
@@ -27,6 +31,120 @@ auto Client::exec(
     return {};
 }
 
+auto Client::upload(
+    const std::string &address,
+    const std::string &serviceName,
+    std::istream &payload,
+    size_t chunkSize,
+    const PartialCallback &partialCallback) -> PayloadSeq
+{
+    ENSURE(0 < chunkSize, RuntimeError);
+
+    auto zmqContext = ZMQContext{ZMQIdentity::unique(), address};
+
+    const auto read = [&payload, chunkSize]() {
+        std::string chunk(chunkSize, '\0');
+
+        payload.read(chunk.data(), std::streamsize(chunkSize));
+        chunk.resize(size_t(payload.gcount()));
+        return chunk;
+    };
+
+    try
+    {
+        ChunkWindow window;
+        /* waits for accept (of oldest chunk in flight), false if request
+         * failed (or worker replied early) - reply is left in reply */
+        PayloadSeq reply;
+        const auto accepted = [&]() {
+            reply = onReply(
+                onMessage(zmqContext.recv(), zmqContext, serviceName));
+
+            if (MDP::Broker::Signature::statusAccepted != reply.front())
+                return false;
+            window.accepted();
+            return true;
+        };
+        /* read ahead - chunk is last if nothing follows */
+        auto chunk = read();
+        auto next  = read();
+
+        for (;;)
+        {
+            while (!window.open())
+            {
+                if (!accepted())
+                {
+                    return collect(
+                        std::move(reply), zmqContext, serviceName,
+                        partialCallback);
+                }
+            }
+
+            const auto last = next.empty();
+
+            onRequest(
+                MDP::Client::makeChunk(
+                    serviceName, window.next(), last, chunk),
+                zmqContext);
+            window.sent();
+
+            if (last) break;
+
+            chunk.swap(next);
+            next = read();
+        }
+
+        /* accepts of chunks in flight precede reply */
+        while (accepted());
+        return collect(
+            std::move(reply), zmqContext, serviceName, partialCallback);
+    }
+    catch (const std::exception &except)
+    {
+        TRACE(TraceLevel::Error, this, " ", except.what(), " aborting");
+        return {};
+    }
+    catch (...)
+    {
+        TRACE(TraceLevel::Error, this, " Unsupported exception, aborting");
+        return {};
+    }
+
+    return {};
+}
+
+auto Client::collect(
+    PayloadSeq reply,
+    ZMQContext &zmqContext,
+    const std::string &serviceName,
+    const PartialCallback &partialCallback) -> PayloadSeq
+{
+    PayloadSeq collected;
+
+    /* Frame 3: status, parts of streamed reply until other status */
+    while (MDP::Broker::Signature::statusPartial == reply.front())
+    {
+        PayloadSeq body{
+            std::make_move_iterator(std::next(std::begin(reply))),
+            std::make_move_iterator(std::end(reply))};
+
+        if (partialCallback) partialCallback(std::move(body));
+        else
+        {
+            collected.insert(
+                std::end(collected), std::make_move_iterator(body.begin()),
+                std::make_move_iterator(body.end()));
+        }
+        reply = onReply(onMessage(zmqContext.recv(), zmqContext, serviceName));
+    }
+    reply.insert(
+        std::next(std::begin(reply)),
+        std::make_move_iterator(std::begin(collected)),
+        std::make_move_iterator(std::end(collected)));
+    return reply;
+}
+
 void Client::onRequest(Message message, ZMQContext &zmqContext)
 {
     TRACE(TraceLevel::Debug, this, " ", message);
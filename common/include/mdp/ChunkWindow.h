@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+
+#include "ensure/Ensure.h"
+#include "mdp/Except.h"
+#include "mdp/MDP.h"
+
+/* client side flow control of chunked request: chunk 1 is sent once chunk 0
+ * is accepted (worker assigned), then at most window chunks are sent but not
+ * accepted (last chunk is answered by reply, never accepted) */
+class ChunkWindow
+{
+    std::size_t window_;
+    std::size_t sent_{0};
+    std::size_t accepted_{0};
+public:
+    explicit ChunkWindow(std::size_t window = MDP::Client::chunkWindow)
+        : window_{window}
+    {
+        ENSURE(0 < window_, RuntimeError);
+    }
+
+    /* number of next chunk */
+    std::size_t next() const { return sent_; }
+    /* chunks sent but not accepted */
+    std::size_t unaccepted() const { return sent_ - accepted_; }
+
+    /* next chunk can be sent without waiting for accept */
+    bool open() const
+    {
+        return 0 == sent_ || 0 < accepted_ && window_ > unaccepted();
+    }
+
+    void sent()
+    {
+        ENSURE(open(), FlowError);
+        ++sent_;
+    }
+
+    /* accept of chunk not sent is protocol error */
+    void accepted()
+    {
+        ENSURE(accepted_ < sent_, FlowError);
+        ++accepted_;
+    }
+};
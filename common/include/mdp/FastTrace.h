@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <zmqpp/zmqpp.hpp>
+
+#include "mdp/MPSCRing.h"
+#include "mdp/ZMQIdentity.h"
+
+/* max level compiled in (0 - Error ... 4 - Trace), FAST_TRACE above it
+ * compiles to nothing */
+#ifndef MDP_TRACE_LEVEL_MAX
+    #define MDP_TRACE_LEVEL_MAX 4
+#endif
+
+/* low overhead tracing for hot paths
+ *
+ * Disabled level costs single relaxed load and branch. Enabled record is
+ * copied in binary form (string literal, short text, few integers) into
+ * lock-free ring and formatted by Writer thread - caller neither allocates
+ * nor formats. Records are dropped if ring is full, Writer reports number of
+ * dropped records. Without Writer records are formatted to std::clog on
+ * caller thread (slow, nothing is lost).
+ *
+ * Independent of TRACE (ensure/Trace.h): runtime level is read from
+ * FAST_TRACE_LEVEL, TRACE keeps its own TRACE_LEVEL. */
+namespace FastTrace {
+
+enum class Level : uint8_t
+{
+    Error,
+    Warning,
+    Info,
+    Debug,
+    Trace
+};
+
+struct Record
+{
+    static constexpr std::size_t valueCapacity = 3;
+    static constexpr std::size_t textCapacity  = 40;
+
+    /* steady clock */
+    uint64_t timestamp_;
+    /* string literal (never copied) */
+    const char *what_;
+    uint64_t values_[valueCapacity];
+    uint32_t thread_;
+    Level level_;
+    uint8_t valueSize_;
+    uint8_t textSize_;
+    char text_[textCapacity];
+};
+
+using Ring = MPSCRing<Record>;
+
+/* runtime threshold (FAST_TRACE_LEVEL environment variable, Info by
+ * default) */
+extern std::atomic<int> threshold;
+
+Ring &ring();
+uint64_t dropped();
+void drop();
+uint32_t threadNo();
+/* Writer consumes ring */
+bool writerRunning();
+/* formats record to std::clog on caller thread */
+void write(const Record &);
+
+inline uint64_t timestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline bool enabled(Level level)
+{
+    return int(level) <= threshold.load(std::memory_order_relaxed);
+}
+
+inline void setLevel(Level level)
+{
+    threshold.store(int(level), std::memory_order_relaxed);
+}
+
+/* text longer than capacity keeps its tail (identities differ at the end) */
+inline void putText(Record &record, const char *data, std::size_t size)
+{
+    if (0 < record.textSize_ && Record::textCapacity > record.textSize_)
+        record.text_[record.textSize_++] = ' ';
+
+    const auto capacity = Record::textCapacity - record.textSize_;
+
+    if (size > capacity)
+    {
+        data += size - capacity;
+        size = capacity;
+    }
+    std::memcpy(record.text_ + record.textSize_, data, size);
+    record.textSize_ += size;
+}
+
+inline void putValue(Record &record, uint64_t value)
+{
+    if (Record::valueCapacity > record.valueSize_)
+        record.values_[record.valueSize_++] = value;
+}
+
+inline void put(Record &record, const ZMQIdentity &identity)
+{
+    putText(record, identity.data(), identity.size());
+}
+
+inline void put(Record &record, const std::string &str)
+{
+    putText(record, str.data(), str.size());
+}
+
+/* message is recorded as frame 0 (identity) and number of frames - body is
+ * never copied */
+inline void put(Record &record, const zmqpp::message &message)
+{
+    if (0 == message.parts()) return;
+
+    putText(
+        record, static_cast<const char *>(message.raw_data(0)),
+        message.size(0));
+    putValue(record, message.parts());
+}
+
+inline void put(Record &record, const std::unique_ptr<zmqpp::message> &handle)
+{
+    if (handle) put(record, *handle);
+}
+
+template <typename T>
+void put(Record &record, const T &value)
+{
+    static_assert(
+        std::is_integral<T>::value || std::is_enum<T>::value,
+        "integral, enum, string or ZMQIdentity expected");
+
+    putValue(record, uint64_t(value));
+}
+
+template <typename... T_n>
+void record(Level level, const char *what, const T_n &...args)
+{
+    Record record;
+
+    record.timestamp_ = timestamp();
+    record.what_      = what;
+    record.thread_    = threadNo();
+    record.level_     = level;
+    record.valueSize_ = 0;
+    record.textSize_  = 0;
+    (put(record, args), ...);
+
+    if (!writerRunning()) write(record);
+    else if (!ring().push(record)) drop();
+}
+
+/* single consumer of ring - formats records to ostream every period and
+ * once more on destruction */
+class Writer
+{
+    std::ostream &os_;
+    std::chrono::milliseconds period_;
+    std::atomic<bool> stop_{false};
+    /* dropped records already reported */
+    uint64_t reported_;
+    std::thread thread_;
+
+    void exec();
+    /* formats all pending records (and number of records dropped since
+     * last flush), returns number of records */
+    std::size_t flush();
+public:
+    explicit Writer(
+        std::ostream &os,
+        std::chrono::milliseconds period = std::chrono::milliseconds{10});
+    ~Writer();
+
+    Writer(const Writer &)            = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    static void format(std::ostream &, const Record &);
+};
+
+} // namespace FastTrace
+
+#define FAST_TRACE(level, ...)                                                 \
+    do                                                                         \
+    {                                                                          \
+        if constexpr (int(FastTrace::Level::level) <= MDP_TRACE_LEVEL_MAX)     \
+        {                                                                      \
+            if (FastTrace::enabled(FastTrace::Level::level))                   \
+                FastTrace::record(FastTrace::Level::level, __VA_ARGS__);       \
+        }                                                                      \
+    } while (0)
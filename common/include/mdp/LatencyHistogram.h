@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+/* log-linear histogram of durations (microseconds)
+ *
+ * Values below 2 * subBuckets are exact, above every power of two range is
+ * split into subBuckets buckets (relative error < 1 / subBuckets). Memory is
+ * fixed and record() does not allocate, bucket index is computed (single
+ * branch for exact range, then count of leading zeros) - no search. */
+class LatencyHistogram
+{
+public:
+    using Duration = std::chrono::microseconds;
+
+    static constexpr std::size_t subBuckets = 32;
+    static constexpr std::size_t subBits    = 5;
+    static constexpr std::size_t size       = (64 - subBits + 1) * subBuckets;
+private:
+    std::array<uint64_t, size> buckets_{};
+    uint64_t count_{0};
+    uint64_t sum_{0};
+    uint64_t min_{std::numeric_limits<uint64_t>::max()};
+    uint64_t max_{0};
+
+    static std::size_t index(uint64_t value)
+    {
+        if (2 * subBuckets > value) return value;
+
+        /* position of most significant bit >= subBits + 1 */
+        const std::size_t msb   = 63 - __builtin_clzll(value);
+        const std::size_t shift = msb - subBits;
+
+        return (shift + 1) * subBuckets + (value >> shift) - subBuckets;
+    }
+
+    /* highest value falling into bucket */
+    static uint64_t upperBound(std::size_t i)
+    {
+        if (2 * subBuckets > i) return i;
+
+        const auto shift = i / subBuckets - 1;
+        const auto sub   = uint64_t(i % subBuckets + subBuckets);
+
+        return ((sub + 1) << shift) - 1;
+    }
+public:
+    void record(Duration duration)
+    {
+        const auto value
+            = uint64_t(std::max(Duration::rep{0}, duration.count()));
+
+        ++buckets_[index(value)];
+        ++count_;
+        sum_ += value;
+        if (min_ > value) min_ = value;
+        if (max_ < value) max_ = value;
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+            buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        if (min_ > other.min_) min_ = other.min_;
+        if (max_ < other.max_) max_ = other.max_;
+    }
+
+    void reset() { *this = LatencyHistogram{}; }
+
+    uint64_t count() const { return count_; }
+    Duration min() const { return Duration(count_ ? min_ : 0); }
+    Duration max() const { return Duration(max_); }
+    Duration mean() const { return Duration(count_ ? sum_ / count_ : 0); }
+
+    /* smallest recorded value v such that q of all values are <= v
+     * (within bucket precision), q in [0, 1] */
+    Duration percentile(double q) const
+    {
+        if (0 == count_) return Duration{0};
+
+        const auto rank = std::max(uint64_t(1), uint64_t(q * count_ + 0.5));
+        uint64_t total  = 0;
+
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            total += buckets_[i];
+            if (rank <= total)
+                return Duration(std::min(upperBound(i), max_));
+        }
+        return max();
+    }
+};
@@ -4,6 +4,8 @@
 
 #include <zmqpp/zmqpp.hpp>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -16,6 +18,32 @@ namespace MDP {
 
 struct EmptyFrame
 { };
+
+/* client envelope as seen by broker ROUTER socket: identity and optional
+ * request id (frame put by client before empty delimiter, used to correlate
+ * replies of many requests in flight - see AsyncClient) */
+struct ClientAddress
+{
+    ZMQIdentity identity_;
+    std::string requestId_;
+
+    ClientAddress() { }
+    ClientAddress(ZMQIdentity identity, std::string requestId = {})
+        : identity_{std::move(identity)}
+        , requestId_{std::move(requestId)}
+    { }
+
+    /* number of envelope frames (identity [+ request id]) */
+    std::size_t frames() const { return requestId_.empty() ? 1 : 2; }
+
+    /* single frame client address passed to worker (opaque to worker),
+     * distinguishes requests of one client in flight on same worker */
+    std::string key() const
+    {
+        if (requestId_.empty()) return identity_.asString();
+        return char(identity_.size()) + identity_.asString() + requestId_;
+    }
+};
 using Message       = zmqpp::message;
 using MessageHandle = std::unique_ptr<Message>;
 
@@ -33,6 +61,8 @@ void append(Message &msg, const EmptyFrame &, const T_n &...tail);
 template <typename... T_n>
 void append(Message &msg, const ZMQIdentity &identity, const T_n &...tail);
 template <typename... T_n>
+void append(Message &msg, const ClientAddress &address, const T_n &...tail);
+template <typename... T_n>
 void append(
     Message &msg, const std::vector<std::string> &seq, const T_n &...tail);
 
@@ -57,6 +87,14 @@ void append(Message &msg, const ZMQIdentity &identity, const T_n &...tail)
     append(msg, tail...);
 }
 
+template <typename... T_n>
+void append(Message &msg, const ClientAddress &address, const T_n &...tail)
+{
+    msg.add_raw(address.identity_.data(), address.identity_.size());
+    if (!address.requestId_.empty()) msg.add(address.requestId_);
+    append(msg, tail...);
+}
+
 template <typename... T_n>
 void append(
     Message &msg, const std::vector<std::string> &seq, const T_n &...tail)
@@ -66,6 +104,55 @@ void append(
     append(msg, tail...);
 }
 
+/* push frames to front of message (in argument order), existing frames are
+ * not copied */
+inline void prepend(Message &) { }
+template <typename T, typename... T_n>
+void prepend(Message &msg, const T &value, const T_n &...tail);
+template <typename... T_n>
+void prepend(Message &msg, const EmptyFrame &, const T_n &...tail);
+template <typename... T_n>
+void prepend(Message &msg, const ZMQIdentity &identity, const T_n &...tail);
+template <typename... T_n>
+void prepend(Message &msg, const ClientAddress &address, const T_n &...tail);
+
+template <typename T, typename... T_n>
+void prepend(Message &msg, const T &value, const T_n &...tail)
+{
+    prepend(msg, tail...);
+    msg.push_front(value);
+}
+
+template <typename... T_n>
+void prepend(Message &msg, const EmptyFrame &, const T_n &...tail)
+{
+    prepend(msg, tail...);
+    msg.push_front(nullptr, 0);
+}
+
+template <typename... T_n>
+void prepend(Message &msg, const ZMQIdentity &identity, const T_n &...tail)
+{
+    prepend(msg, tail...);
+    msg.push_front(identity.data(), identity.size());
+}
+
+template <typename... T_n>
+void prepend(Message &msg, const ClientAddress &address, const T_n &...tail)
+{
+    prepend(msg, tail...);
+    if (!address.requestId_.empty()) msg.push_front(address.requestId_);
+    msg.push_front(address.identity_.data(), address.identity_.size());
+}
+
+/* remove n frames from front of message */
+inline void popFront(Message &msg, std::size_t n)
+{
+    ENSURE(n <= msg.parts(), MessageFormatInvalid);
+    while (n--)
+        msg.pop_front();
+}
+
 template <typename... T_n>
 Message makeMessage(const T_n &...tail)
 {
@@ -79,8 +166,19 @@ namespace Client {
 
 namespace Signature {
 constexpr auto self = "MDPC01";
+/* request with deadline (extension) */
+constexpr auto deadline = "MDPCD1";
+/* chunk of chunked request (extension) */
+constexpr auto chunk = "MDPCU1";
+/* chunk flag - more chunks follow / last chunk of request */
+constexpr auto more = "more";
+constexpr auto last = "last";
 } // namespace Signature
 
+/* max number of chunks of chunked request sent but not accepted (bounds
+ * chunks buffered by broker and worker per request) */
+constexpr std::size_t chunkWindow = 4;
+
 /* Client REQUEST:
  *  Frame 0: Empty (zero bytes, invisible to REQ application)
  *  Frame 1: "MDPC01" (six bytes, representing MDP/Client v0.1)
@@ -92,6 +190,62 @@ Message makeReq(const std::string &service, const T_n &...body)
     return makeMessage(EmptyFrame{}, Signature::self, service, body...);
 }
 
+/* Client REQUEST with request id (extension):
+ *  Frame 0: Request id (non empty, echoed back in reply)
+ *  Frames 1+: Client REQUEST */
+template <typename... T_n>
+Message makeReqWithId(
+    const std::string &requestId,
+    const std::string &service,
+    const T_n &...body)
+{
+    return makeMessage(
+        requestId, EmptyFrame{}, Signature::self, service, body...);
+}
+
+/* Client REQUEST with request id and deadline (extension):
+ *  Frame 0: Request id (non empty, echoed back in reply)
+ *  Frame 1: Empty
+ *  Frame 2: "MDPCD1" (six bytes)
+ *  Frame 3: Service name (printable string)
+ *  Frame 4: Deadline - milliseconds since broker received request (decimal)
+ *  Frames 5+: Request body (opaque binary)
+ * Broker replies "service timeout" if no reply arrives before deadline,
+ * replies are plain Client REPLY ("MDPC01"). */
+template <typename... T_n>
+Message makeReqWithDeadline(
+    const std::string &requestId,
+    const std::string &service,
+    std::chrono::milliseconds deadline,
+    const T_n &...body)
+{
+    return makeMessage(
+        requestId, EmptyFrame{}, Signature::deadline, service,
+        std::to_string(deadline.count()), body...);
+}
+
+/* Client CHUNK (extension, chunked request):
+ *  Frame 0: Empty
+ *  Frame 1: "MDPCU1" (six bytes)
+ *  Frame 2: Service name (printable string)
+ *  Frame 3: Chunk number (decimal, chunk 0 opens request)
+ *  Frame 4: "more" or "last"
+ *  Frames 5+: Chunk body (opaque binary)
+ * Broker replies "accepted" (no body) when worker takes chunk other than
+ * last. Chunk 1 is sent once chunk 0 is accepted (worker assigned), then at
+ * most chunkWindow chunks are not accepted. Reply is plain Client REPLY. */
+template <typename... T_n>
+Message makeChunk(
+    const std::string &service,
+    std::size_t no,
+    bool last,
+    const T_n &...body)
+{
+    return makeMessage(
+        EmptyFrame{}, Signature::chunk, service, std::to_string(no),
+        last ? Signature::last : Signature::more, body...);
+}
+
 } // namespace Client
 
 namespace Worker {
@@ -103,17 +257,76 @@ constexpr auto request    = "\x2";
 constexpr auto reply      = "\x3";
 constexpr auto heartbeat  = "\x4";
 constexpr auto disconnect = "\x5";
+/* broker -> worker (extension) */
+constexpr auto cancel     = "\x6";
+/* worker -> broker (extension) - part of streamed reply, REPLY ends it */
+constexpr auto partial    = "\x7";
+/* broker -> worker (extension) - chunk of chunked request */
+constexpr auto chunk      = "\x8";
+/* worker -> broker (extension) - chunk taken, client may send next one */
+constexpr auto accept     = "\x9";
+/* worker -> broker (extension) - request failed (e.g. chunked request
+ * abandoned), ends request as REPLY does */
+constexpr auto failure    = "\xA";
 } // namespace Signature
 
+namespace Property {
+/* max number of requests broker keeps in flight to worker (credit window,
+ * 1 if omitted), requests beyond worker concurrency wait in worker (hides
+ * broker round trip) */
+constexpr auto credits = "credits";
+/* number of worker task threads as advertised by earlier workers, credits
+ * (equal to slots) are assumed if only slots is present */
+constexpr auto slots = "slots";
+/* worker accepts CANCEL of requests not yet processed ("1"), worker replies
+ * (with empty body) to every cancelled request anyway */
+constexpr auto cancel = "cancel";
+/* worker accepts chunked requests ("1"), chunked request worker could not
+ * complete is answered by FAILURE */
+constexpr auto chunked = "chunked";
+/* heartbeat period in milliseconds proposed by worker (0 - broker decides),
+ * broker replies with HEARTBEAT carrying effective period and liveness,
+ * broker settings apply only to workers which announce it */
+constexpr auto heartbeat = "heartbeat";
+/* number of missed heartbeats after which peer is considered dead */
+constexpr auto liveness = "liveness";
+} // namespace Property
+
+inline std::string
+makeProperty(const std::string &key, const std::string &value)
+{
+    return key + '=' + value;
+}
+
+/* value of property (key=value frame) in frames first+, empty if not
+ * present */
+inline std::string
+property(const Message &msg, const std::string &key, std::size_t first)
+{
+    const auto prefix = key + '=';
+
+    for (std::size_t i = first; i < msg.parts(); ++i)
+    {
+        const auto frame = msg.get(i);
+
+        if (0 == frame.compare(0, prefix.size(), prefix))
+            return frame.substr(prefix.size());
+    }
+    return {};
+}
+
 /* Worker READY
  *  Frame 0: Empty frame
  *  Frame 1: "MDPW01" (six bytes, representing MDP/Worker v0.1)
  *  Frame 2: 0x01 (one byte, representing READY)
- *  Frame 3: Service name (printable string) */
-inline Message makeReady(const std::string &service)
+ *  Frame 3: Service name (printable string)
+ *  Frames 4+: Properties (key=value, extension - optional) */
+template <typename... T_n>
+Message makeReady(const std::string &service, const T_n &...properties)
 {
     return makeMessage(
-        EmptyFrame{}, Signature::self, Signature::ready, service);
+        EmptyFrame{}, Signature::self, Signature::ready, service,
+        properties...);
 }
 
 /* Worker  REPLY
@@ -131,6 +344,46 @@ Message makeRep(const ZMQIdentity &identity, const T_n &...body)
         body...);
 }
 
+/* Worker PARTIAL (extension, streamed reply - any number of PARTIALs
+ * followed by REPLY)
+ *  Frame 0: Empty frame
+ *  Frame 1: "MDPW01" (six bytes, representing MDP/Worker v0.1)
+ *  Frame 2: 0x07 (one byte, representing PARTIAL)
+ *  Frame 3: Client address (envelope stack)
+ *  Frame 4: Empty (zero bytes, envelope delimiter)
+ *  Frames 5+: Reply body part (opaque binary) */
+template <typename... T_n>
+Message makePartial(const ZMQIdentity &identity, const T_n &...body)
+{
+    return makeMessage(
+        EmptyFrame{}, Signature::self, Signature::partial, identity,
+        EmptyFrame{}, body...);
+}
+
+/* Worker ACCEPT (extension, chunk of chunked request taken)
+ *  Frame 0: Empty frame
+ *  Frame 1: "MDPW01" (six bytes, representing MDP/Worker v0.1)
+ *  Frame 2: 0x09 (one byte, representing ACCEPT)
+ *  Frame 3: Client address (envelope stack) */
+inline Message makeAccept(const ZMQIdentity &identity)
+{
+    return makeMessage(
+        EmptyFrame{}, Signature::self, Signature::accept, identity);
+}
+
+/* Worker FAILURE (extension, request failed - client gets failure reply)
+ *  Frame 0: Empty frame
+ *  Frame 1: "MDPW01" (six bytes, representing MDP/Worker v0.1)
+ *  Frame 2: 0x0A (one byte, representing FAILURE)
+ *  Frame 3: Client address (envelope stack)
+ *  Frame 4: Empty (zero bytes, envelope delimiter) */
+inline Message makeFailure(const ZMQIdentity &identity)
+{
+    return makeMessage(
+        EmptyFrame{}, Signature::self, Signature::failure, identity,
+        EmptyFrame{});
+}
+
 /* Worker HEARTBEAT
  *  Frame 0: Empty frame
  *  Frame 1: "MDPW01" (six bytes, representing MDP/Worker v0.1)
@@ -159,32 +412,113 @@ constexpr auto serviceUnsupported = "service unsupported";
 constexpr auto serviceBusy        = "service busy";
 constexpr auto serviceRegistered  = "service registered";
 constexpr auto serviceFailure     = "service failure";
+constexpr auto serviceOverloaded  = "service overloaded";
+constexpr auto serviceTimeout     = "service timeout";
+constexpr auto serviceStalled     = "service stalled";
 constexpr auto statusSucess       = "success";
 constexpr auto statusFailure      = "failure";
+/* part of streamed reply, reply with other status ends it (extension) */
+constexpr auto statusPartial      = "partial";
+/* chunk of chunked request taken by worker (extension) */
+constexpr auto statusAccepted     = "accepted";
+/* MMI reply status (first body frame, https://rfc.zeromq.org/spec:8/MMI/) */
+constexpr auto mmiFound           = "200";
+constexpr auto mmiNotFound        = "404";
+constexpr auto mmiNotImplemented  = "501";
 } // namespace Signature
 
+/* number of client envelope frames of Client REQUEST received by ROUTER
+ * (identity and optional request id preceding empty delimiter) */
+inline std::size_t clientFrames(const Message &msg)
+{
+    return 1 < msg.parts() && 0 != msg.size(1) ? 2 : 1;
+}
+
+/* deadline of Client REQUEST with deadline, deadline frame is removed (message
+ * is left as plain Client REQUEST), 0 if none (or invalid) */
+inline std::chrono::milliseconds takeDeadline(Message &msg)
+{
+    const auto n = clientFrames(msg);
+
+    /* Frame n + 1: signature, n + 2: service name, n + 3: deadline */
+    if (n + 4 > msg.parts() || Client::Signature::deadline != msg.get(n + 1))
+        return std::chrono::milliseconds{0};
+
+    const auto value  = msg.get(n + 3);
+    uint64_t deadline = 0;
+
+    msg.remove(n + 3);
+
+    if (value.empty() || 9 < value.size()) return std::chrono::milliseconds{0};
+    for (const auto c : value)
+    {
+        if ('0' > c || '9' < c) return std::chrono::milliseconds{0};
+        deadline = deadline * 10 + (c - '0');
+    }
+    return std::chrono::milliseconds{deadline};
+}
+
+inline ClientAddress clientAddress(const Message &msg)
+{
+    ENSURE(0 < msg.parts(), MessageFormatInvalid);
+
+    if (1 == clientFrames(msg)) return ClientAddress{msg.get(0)};
+    return ClientAddress{msg.get(0), msg.get(1)};
+}
+
+/* value of READY property (frames 5+ as received by ROUTER), empty if
+ * not present */
+inline std::string readyProperty(const Message &msg, const std::string &key)
+{
+    return Worker::property(msg, key, 5);
+}
+
 /* Client REPLY:
  *  Frame 0: Identity
+ *  (Frame 0a: Request id - only if present in request)
  *  Frame 1: Empty (zero bytes, invisible to REQ application)
  *  Frame 2: "MDPC01" (six bytes, representing MDP/Client v0.1)
  *  Frame 3: Service name (printable string)
- *  Frame 4: status (success | failure)
+ *  Frame 4: status (success | failure | partial)
  *  Frames 5+: Reply body (opaque binary) */
 template <typename... T_n>
 Message makeSucessClientRep(
-    const ZMQIdentity &identity, const std::string &service, const T_n &...body)
+    const ClientAddress &address,
+    const std::string &service,
+    const T_n &...body)
 {
     return makeMessage(
-        identity, EmptyFrame{}, Client::Signature::self, service,
+        address, EmptyFrame{}, Client::Signature::self, service,
         Broker::Signature::statusSucess, body...);
 }
 
+template <typename... T_n>
+Message makePartialClientRep(
+    const ClientAddress &address,
+    const std::string &service,
+    const T_n &...body)
+{
+    return makeMessage(
+        address, EmptyFrame{}, Client::Signature::self, service,
+        Broker::Signature::statusPartial, body...);
+}
+
+inline Message
+makeAcceptedClientRep(const ClientAddress &address, const std::string &service)
+{
+    return makeMessage(
+        address, EmptyFrame{}, Client::Signature::self, service,
+        Broker::Signature::statusAccepted);
+}
+
 template <typename... T_n>
 Message makeFailureClientRep(
-    const ZMQIdentity &identity, const std::string &service, const T_n &...body)
+    const ClientAddress &address,
+    const std::string &service,
+    const T_n &...body)
 {
     return makeMessage(
-        identity, EmptyFrame{}, Client::Signature::self, service,
+        address, EmptyFrame{}, Client::Signature::self, service,
         Broker::Signature::statusFailure, body...);
 }
 
@@ -207,16 +541,95 @@ Message makeWorkerReq(
         Worker::Signature::request, clientIdentity, EmptyFrame{}, body...);
 }
 
+/* Client REQUEST -> Worker REQUEST (in place, body frames are moved not
+ * copied)
+ *  Frame 0: Identity (client)    -> Identity (worker)
+ *  (Frame 0a: Request id)
+ *  Frame 1: Empty                -> Empty
+ *  Frame 2: "MDPC01"             -> "MDPW01"
+ *  Frame 3: Service name         -> 0x02
+ *                                -> Client address (key)
+ *                                -> Empty
+ *  Frames 4+: Request body       -> Frames 6+: Request body */
+inline void toWorkerReq(
+    Message &msg,
+    const ClientAddress &clientAddress,
+    const ZMQIdentity &workerIdentity,
+    const char *command = Worker::Signature::request)
+{
+    ENSURE(3 + clientAddress.frames() <= msg.parts(), MessageFormatInvalid);
+
+    popFront(msg, 3 + clientAddress.frames());
+    prepend(
+        msg, workerIdentity, EmptyFrame{}, Worker::Signature::self, command,
+        clientAddress.key(), EmptyFrame{});
+}
+
+/* Client CHUNK -> Worker CHUNK (in place, same as Client REQUEST)
+ *  Frame 2: "MDPCU1"             -> "MDPW01"
+ *  Frame 3: Service name         -> 0x08
+ *  Frames 4+: Chunk number, flag, chunk body -> Frames 6+ */
+inline void toWorkerChunk(
+    Message &msg,
+    const ClientAddress &clientAddress,
+    const ZMQIdentity &workerIdentity)
+{
+    toWorkerReq(msg, clientAddress, workerIdentity, Worker::Signature::chunk);
+}
+
+/* Worker REPLY (PARTIAL) -> Client REPLY (in place, body frames are moved
+ * not copied)
+ *  Frame 0: Identity (worker)    -> Identity (client)
+ *                                -> (Request id)
+ *  Frame 1: Empty                -> Empty
+ *  Frame 2: "MDPW01"             -> "MDPC01"
+ *  Frame 3: 0x03 (0x07)          -> Service name
+ *  Frame 4: Client address       -> status (success or partial)
+ *  Frame 5: Empty
+ *  Frames 6+: Reply body         -> Frames 5+: Reply body */
+inline void toClientRep(
+    Message &msg,
+    const ClientAddress &clientAddress,
+    const std::string &service,
+    const char *status)
+{
+    ENSURE(6 <= msg.parts(), MessageFormatInvalid);
+
+    popFront(msg, 6);
+    prepend(
+        msg, clientAddress, EmptyFrame{}, Client::Signature::self, service,
+        status);
+}
+
+inline void toSucessClientRep(
+    Message &msg,
+    const ClientAddress &clientAddress,
+    const std::string &service)
+{
+    toClientRep(msg, clientAddress, service, Broker::Signature::statusSucess);
+}
+
+inline void toPartialClientRep(
+    Message &msg,
+    const ClientAddress &clientAddress,
+    const std::string &service)
+{
+    toClientRep(msg, clientAddress, service, Broker::Signature::statusPartial);
+}
+
 /* Worker HEARTBEAT
  *  Frame 0: Identity
  *  Frame 1: Empty frame
  *  Frame 2: "MDPW01" (six bytes, representing MDP/Worker v0.1)
- *  Frame 3: 0x04 (one byte, representing HEARTBEAT) */
-inline Message makeHeartbeat(const ZMQIdentity &identity)
+ *  Frame 3: 0x04 (one byte, representing HEARTBEAT)
+ *  Frames 4+: Properties (key=value, extension - effective heartbeat and
+ *  liveness in reply to READY proposing them) */
+template <typename... T_n>
+Message makeHeartbeat(const ZMQIdentity &identity, const T_n &...properties)
 {
     return makeMessage(
         identity, EmptyFrame{}, Worker::Signature::self,
-        Worker::Signature::heartbeat);
+        Worker::Signature::heartbeat, properties...);
 }
 
 /* Worker DISCONNECT
@@ -231,6 +644,19 @@ inline Message makeDisconnect(const ZMQIdentity &identity)
         Worker::Signature::disconnect);
 }
 
+/* Worker CANCEL (extension)
+ *  Frame 0: Identity (worker)
+ *  Frame 1: Empty frame
+ *  Frame 2: "MDPW01"
+ *  Frame 3: 0x06 (one byte, representing CANCEL)
+ *  Frame 4: Client address (key) of request to cancel */
+inline Message makeCancel(const ZMQIdentity &identity, const std::string &key)
+{
+    return makeMessage(
+        identity, EmptyFrame{}, Worker::Signature::self,
+        Worker::Signature::cancel, key);
+}
+
 } // namespace Broker
 } // namespace MDP
 
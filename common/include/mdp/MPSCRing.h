@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "ensure/Ensure.h"
+#include "mdp/Except.h"
+
+/* bounded lock-free multi producer, single consumer ring (sequence number
+ * per cell, D. Vyukov bounded queue)
+ *
+ * push() never blocks or allocates - fails if ring is full */
+template <typename T>
+class MPSCRing
+{
+    struct Cell
+    {
+        std::atomic<std::size_t> seq_;
+        T value_;
+    };
+
+    /* keep producer and consumer counters on separate cache lines */
+    static constexpr std::size_t cacheLine = 64;
+
+    const std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(cacheLine) std::atomic<std::size_t> enqueuePos_{0};
+    alignas(cacheLine) std::size_t dequeuePos_{0};
+public:
+    /* capacity - power of 2 */
+    explicit MPSCRing(std::size_t capacity)
+        : mask_{capacity - 1}
+        , cells_{new Cell[capacity]}
+    {
+        ENSURE(1 < capacity && 0 == (capacity & mask_), RuntimeError);
+
+        for (std::size_t i = 0; i < capacity; ++i)
+            cells_[i].seq_.store(i, std::memory_order_relaxed);
+    }
+
+    MPSCRing(const MPSCRing &)            = delete;
+    MPSCRing &operator=(const MPSCRing &) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    /* any thread */
+    bool push(const T &value)
+    {
+        auto pos = enqueuePos_.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            auto &cell      = cells_[pos & mask_];
+            const auto seq  = cell.seq_.load(std::memory_order_acquire);
+            const auto diff = intptr_t(seq) - intptr_t(pos);
+
+            if (0 == diff)
+            {
+                if (enqueuePos_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value_ = value;
+                    cell.seq_.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            /* cell not consumed yet - full */
+            else if (0 > diff) return false;
+            else pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    /* consumer thread only */
+    bool pop(T &value)
+    {
+        auto &cell     = cells_[dequeuePos_ & mask_];
+        const auto seq = cell.seq_.load(std::memory_order_acquire);
+
+        if (seq != dequeuePos_ + 1) return false;
+
+        value = cell.value_;
+        cell.seq_.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+        ++dequeuePos_;
+        return true;
+    }
+};
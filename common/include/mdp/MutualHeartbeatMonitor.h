@@ -1,23 +1,44 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <ostream>
 
 class MutualHeartbeatMonitor
 {
+public:
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+private:
     std::chrono::milliseconds period_;
+    /* number of periods without peer heartbeat after which peer is dead */
+    std::size_t liveness_;
     std::chrono::steady_clock::time_point selfTimestamp_;
     std::chrono::steady_clock::time_point peerTimestamp_;
 
     std::chrono::milliseconds peerDiff() const;
     std::chrono::milliseconds selfDiff() const;
 public:
+    static constexpr std::size_t defaultLiveness = 3;
+
     explicit MutualHeartbeatMonitor(
-        std::chrono::milliseconds period = std::chrono::seconds{3});
+        std::chrono::milliseconds period = std::chrono::seconds{3},
+        std::size_t liveness             = defaultLiveness);
 
     std::chrono::milliseconds period() const;
+    std::size_t liveness() const;
+    /* change period and liveness (negotiated), timestamps are kept */
+    void configure(std::chrono::milliseconds period, std::size_t liveness);
     bool peerHeartbeatExpired() const;
+    bool peerHeartbeatExpired(TimePoint now) const;
     bool shouldHeartbeat() const;
+    bool shouldHeartbeat(TimePoint now) const;
+    /* time point at which peer heartbeat expires */
+    TimePoint peerDeadline() const;
+    /* time point at which self heartbeat should be sent */
+    TimePoint selfDeadline() const;
+    /* nearest of peer and self deadline */
+    TimePoint deadline() const;
     void selfHeartbeat();
     void peerHeartbeat();
     void reset();
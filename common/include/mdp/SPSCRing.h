@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "ensure/Ensure.h"
+#include "mdp/Except.h"
+
+/* bounded lock-free single producer, single consumer ring (move only values
+ * supported, e.g. message handles)
+ *
+ * push() never blocks or allocates - fails if ring is full */
+template <typename T>
+class SPSCRing
+{
+    /* keep producer and consumer counters on separate cache lines */
+    static constexpr std::size_t cacheLine = 64;
+
+    const std::size_t mask_;
+    std::unique_ptr<T[]> cells_;
+    alignas(cacheLine) std::atomic<std::size_t> tail_{0};
+    alignas(cacheLine) std::atomic<std::size_t> head_{0};
+public:
+    /* capacity - power of 2 */
+    explicit SPSCRing(std::size_t capacity)
+        : mask_{capacity - 1}
+        , cells_{new T[capacity]}
+    {
+        ENSURE(1 < capacity && 0 == (capacity & mask_), RuntimeError);
+    }
+
+    SPSCRing(const SPSCRing &)            = delete;
+    SPSCRing &operator=(const SPSCRing &) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    /* producer thread only (consumer may pop any time) */
+    bool full() const
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+
+        return tail - head_.load(std::memory_order_acquire) > mask_;
+    }
+
+    /* producer thread only, value is left intact if ring is full */
+    bool push(T &&value)
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+
+        if (tail - head_.load(std::memory_order_acquire) > mask_) return false;
+
+        cells_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* consumer thread only */
+    bool pop(T &value)
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+
+        value = std::move(cells_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "ensure/Ensure.h"
+#include "mdp/Except.h"
+
+/* min-heap of (deadline, key) timers
+ *
+ * Timers are never cancelled or moved - owner is expected to validate
+ * key on expiry and reschedule if deadline moved forward in the meantime
+ * (lazy update, keeps schedule() O(log n) and avoids per-key bookkeeping),
+ * timers made stale long before their deadline can be purged in bulk */
+template <typename Key>
+class TimerQueue
+{
+public:
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    struct Timer
+    {
+        TimePoint deadline_;
+        Key key_;
+    };
+private:
+    std::vector<Timer> heap_;
+
+    static bool later(const Timer &x, const Timer &y)
+    {
+        return x.deadline_ > y.deadline_;
+    }
+public:
+    bool empty() const { return heap_.empty(); }
+    std::size_t size() const { return heap_.size(); }
+    void clear() { heap_.clear(); }
+
+    /* nearest deadline */
+    TimePoint deadline() const
+    {
+        ENSURE(!empty(), FlowError);
+        return heap_.front().deadline_;
+    }
+
+    void schedule(TimePoint deadline, Key key)
+    {
+        heap_.push_back(Timer{deadline, std::move(key)});
+        std::push_heap(std::begin(heap_), std::end(heap_), later);
+    }
+
+    /* f(key, deadline) is called for every timer with deadline <= now
+     * (in deadline order), f may schedule new timers (deadline > now) */
+    template <typename F>
+    std::size_t expire(TimePoint now, F f)
+    {
+        std::size_t num = 0;
+
+        while (!empty() && now >= heap_.front().deadline_)
+        {
+            std::pop_heap(std::begin(heap_), std::end(heap_), later);
+
+            auto timer = std::move(heap_.back());
+
+            heap_.pop_back();
+            f(std::move(timer.key_), timer.deadline_);
+            ++num;
+        }
+        return num;
+    }
+
+    /* removes every timer for which stale(key, deadline) is true, O(n),
+     * returns number of removed timers */
+    template <typename F>
+    std::size_t purge(F stale)
+    {
+        const auto end = std::remove_if(
+            std::begin(heap_), std::end(heap_), [&stale](const Timer &timer) {
+                return stale(timer.key_, timer.deadline_);
+            });
+        const auto num = std::size_t(std::distance(end, std::end(heap_)));
+
+        heap_.erase(end, std::end(heap_));
+        std::make_heap(std::begin(heap_), std::end(heap_), later);
+        return num;
+    }
+
+    /* time left to nearest deadline (rounded up), bounded by max */
+    std::chrono::milliseconds
+    timeout(TimePoint now, std::chrono::milliseconds max) const
+    {
+        if (empty()) return max;
+        if (now >= deadline()) return std::chrono::milliseconds{0};
+
+        return std::min(
+            max,
+            std::chrono::ceil<std::chrono::milliseconds>(deadline() - now));
+    }
+};
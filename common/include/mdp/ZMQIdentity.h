@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 
 #include "ensure/Ensure.h"
@@ -45,3 +46,16 @@ inline bool operator!=(const ZMQIdentity &x, const ZMQIdentity &y)
 {
     return !(x == y);
 }
+
+namespace std {
+
+template <>
+struct hash<ZMQIdentity>
+{
+    size_t operator()(const ZMQIdentity &identity) const noexcept
+    {
+        return hash<string>{}(identity.asString());
+    }
+};
+
+} // namespace std
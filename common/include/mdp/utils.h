@@ -1,5 +1,8 @@
 #pragma once
 
+#include <optional>
+#include <string>
+
 #include <zmqpp/zmqpp.hpp>
 
 #include "ensure/Ensure.h"
@@ -14,4 +17,9 @@ enum class IOMode
 
 MDP::MessageHandle recv(zmqpp::socket &, IOMode);
 void send(zmqpp::socket &socket, MDP::Message, IOMode);
+/* non-blocking send, false if send would block (message is left intact) */
+bool trySend(zmqpp::socket &socket, MDP::Message &);
 std::string asHex(const uint8_t *begin, const uint8_t *end);
+/* decimal number (digits only - no sign, no whitespace), nullopt if invalid
+ * or out of range (command line options, protocol properties) */
+std::optional<size_t> parseNumber(const std::string &);
@@ -0,0 +1,144 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "ensure/Ensure.h"
+#include "mdp/Except.h"
+#include "mdp/FastTrace.h"
+
+namespace FastTrace {
+namespace {
+
+/* ~1.5MB, enough to absorb bursts between Writer periods */
+constexpr std::size_t ringCapacity = 1 << 14;
+
+std::atomic<uint64_t> dropped_{0};
+std::atomic<uint32_t> threadCntr_{0};
+std::atomic<bool> writerRunning_{false};
+/* records go to ring (false - written on caller thread) */
+std::atomic<bool> ringConsumed_{false};
+
+int levelFromEnv()
+{
+    const char *level = std::getenv("FAST_TRACE_LEVEL");
+
+    if (nullptr == level) return int(Level::Info);
+    return std::atoi(level);
+}
+
+} // namespace
+
+std::atomic<int> threshold{levelFromEnv()};
+
+Ring &ring()
+{
+    static Ring ring_{ringCapacity};
+    return ring_;
+}
+
+uint64_t dropped()
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+void drop()
+{
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t threadNo()
+{
+    thread_local const uint32_t no = threadCntr_.fetch_add(1);
+    return no;
+}
+
+bool writerRunning()
+{
+    return ringConsumed_.load(std::memory_order_acquire);
+}
+
+void write(const Record &record)
+{
+    static std::mutex mutex;
+    std::ostringstream os;
+
+    Writer::format(os, record);
+
+    std::lock_guard<std::mutex> lock{mutex};
+
+    std::clog << os.str() << std::flush;
+}
+
+Writer::Writer(std::ostream &os, std::chrono::milliseconds period)
+    : os_{os}
+    , period_{period}
+    , reported_{dropped()}
+{
+    /* ring has single consumer */
+    ENSURE(!writerRunning_.exchange(true), RuntimeError);
+    /* construct ring before first producer (not on hot path) */
+    ring();
+    thread_       = std::thread{[this]() { exec(); }};
+    ringConsumed_ = true;
+}
+
+Writer::~Writer()
+{
+    /* records after final flush are written by their producers */
+    ringConsumed_ = false;
+    stop_         = true;
+    thread_.join();
+    flush();
+    writerRunning_ = false;
+}
+
+void Writer::exec()
+{
+    while (!stop_)
+    {
+        if (0 == flush()) std::this_thread::sleep_for(period_);
+    }
+}
+
+std::size_t Writer::flush()
+{
+    std::size_t num = 0;
+    Record record;
+
+    while (ring().pop(record))
+    {
+        format(os_, record);
+        ++num;
+    }
+
+    const auto dropped = FastTrace::dropped();
+
+    if (reported_ != dropped)
+    {
+        os_ << "fast trace: " << dropped - reported_ << " records dropped\n";
+        reported_ = dropped;
+        ++num;
+    }
+    if (num) os_.flush();
+    return num;
+}
+
+void Writer::format(std::ostream &os, const Record &record)
+{
+    static const char *name[] = {"E", "W", "I", "D", "T"};
+
+    os << record.timestamp_ / 1000 << " [" << record.thread_ << "] "
+       << (Level::Trace >= record.level_ ? name[int(record.level_)] : "?")
+       << ' ' << record.what_;
+
+    if (0 < record.textSize_)
+        os << ' ' << std::string(record.text_, record.textSize_);
+
+    for (uint8_t i = 0; i < record.valueSize_; ++i)
+        os << ' ' << record.values_[i];
+    os << '\n';
+}
+
+} // namespace FastTrace
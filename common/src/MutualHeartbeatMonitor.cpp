@@ -1,5 +1,7 @@
 #include "mdp/MutualHeartbeatMonitor.h"
 
+#include <algorithm>
+
 std::chrono::milliseconds MutualHeartbeatMonitor::peerDiff() const
 {
     const auto diff = std::chrono::steady_clock::now() - peerTimestamp_;
@@ -16,8 +18,10 @@ std::chrono::milliseconds MutualHeartbeatMonitor::selfDiff() const
     return msDiff;
 }
 
-MutualHeartbeatMonitor::MutualHeartbeatMonitor(std::chrono::milliseconds period)
+MutualHeartbeatMonitor::MutualHeartbeatMonitor(
+    std::chrono::milliseconds period, std::size_t liveness)
     : period_{period}
+    , liveness_{liveness}
     , selfTimestamp_{std::chrono::steady_clock::now()}
     , peerTimestamp_{selfTimestamp_}
 { }
@@ -26,13 +30,43 @@ std::chrono::milliseconds MutualHeartbeatMonitor::period() const
 {
     return period_;
 }
+std::size_t MutualHeartbeatMonitor::liveness() const
+{
+    return liveness_;
+}
+void MutualHeartbeatMonitor::configure(
+    std::chrono::milliseconds period, std::size_t liveness)
+{
+    period_   = period;
+    liveness_ = liveness;
+}
 bool MutualHeartbeatMonitor::peerHeartbeatExpired() const
 {
-    return peerDiff() > 3 * period();
+    return peerHeartbeatExpired(Clock::now());
+}
+bool MutualHeartbeatMonitor::peerHeartbeatExpired(TimePoint now) const
+{
+    return now >= peerDeadline();
 }
 bool MutualHeartbeatMonitor::shouldHeartbeat() const
 {
-    return selfDiff() > period();
+    return shouldHeartbeat(Clock::now());
+}
+bool MutualHeartbeatMonitor::shouldHeartbeat(TimePoint now) const
+{
+    return now >= selfDeadline();
+}
+auto MutualHeartbeatMonitor::peerDeadline() const -> TimePoint
+{
+    return peerTimestamp_ + liveness_ * period();
+}
+auto MutualHeartbeatMonitor::selfDeadline() const -> TimePoint
+{
+    return selfTimestamp_ + period();
+}
+auto MutualHeartbeatMonitor::deadline() const -> TimePoint
+{
+    return std::min(peerDeadline(), selfDeadline());
 }
 void MutualHeartbeatMonitor::selfHeartbeat()
 {
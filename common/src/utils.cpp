@@ -1,3 +1,4 @@
+#include <charconv>
 #include <iterator>
 
 #include "mdp/utils.h"
@@ -31,6 +32,11 @@ void send(zmqpp::socket &socket, MDP::Message message, IOMode ioMode)
     ENSURE(status, SendFailed);
 }
 
+bool trySend(zmqpp::socket &socket, MDP::Message &message)
+{
+    return socket.send(message, true /* dont_block */);
+}
+
 std::string asHex(const uint8_t *begin, const uint8_t *const end)
 {
     if (begin == end) return {};
@@ -46,3 +52,15 @@ std::string asHex(const uint8_t *begin, const uint8_t *const end)
     }
     return r;
 }
+
+std::optional<size_t> parseNumber(const std::string &str)
+{
+    size_t value      = 0;
+    const auto *begin = str.data();
+    const auto *end   = begin + str.size();
+    const auto result = std::from_chars(begin, end, value);
+
+    if (str.empty() || std::errc{} != result.ec || end != result.ptr)
+        return std::nullopt;
+    return value;
+}
@@ -0,0 +1,133 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mdp/OutboundQueue.h"
+
+namespace {
+
+OutboundQueue::Config config(size_t depth)
+{
+    OutboundQueue::Config config;
+
+    config.depth = depth;
+    return config;
+}
+
+/* message to peer (frame 0) */
+MDP::Message message(const std::string &peer, const std::string &body)
+{
+    MDP::Message message;
+
+    message.add(peer);
+    message.add(body);
+    return message;
+}
+
+} /* namespace */
+
+TEST(OutboundQueueTests, DepthPerPeer)
+{
+    OutboundQueue queue{config(2)};
+    const auto a = ZMQIdentity{"a"};
+    const auto b = ZMQIdentity{"b"};
+
+    ASSERT_TRUE(queue.empty());
+    ASSERT_FALSE(queue.queued(a));
+    ASSERT_TRUE(queue.push(a, message("a", "1")));
+    ASSERT_TRUE(queue.push(a, message("a", "2")));
+    ASSERT_TRUE(queue.queued(a));
+    ASSERT_TRUE(queue.full(a));
+
+    /* full queue of one peer does not block the other */
+    ASSERT_FALSE(queue.push(a, message("a", "3")));
+    ASSERT_FALSE(queue.full(b));
+    ASSERT_TRUE(queue.push(b, message("b", "1")));
+    ASSERT_EQ(queue.size(), 3);
+}
+
+TEST(OutboundQueueTests, RetryUntilSent)
+{
+    OutboundQueue queue{config(4)};
+    std::vector<std::string> sent;
+    bool blocked = true;
+    const auto trySend = [&sent, &blocked](MDP::Message &message) {
+        /* EAGAIN - message stays queued */
+        if (blocked) return false;
+        sent.push_back(message.get(1));
+        return true;
+    };
+
+    queue.push(ZMQIdentity{"a"}, message("a", "1"));
+    queue.push(ZMQIdentity{"a"}, message("a", "2"));
+
+    ASSERT_EQ(queue.drain(trySend), 0);
+    ASSERT_EQ(queue.size(), 2);
+    ASSERT_TRUE(queue.queued(ZMQIdentity{"a"}));
+
+    blocked = false;
+    ASSERT_EQ(queue.drain(trySend), 2);
+    ASSERT_EQ(sent, (std::vector<std::string>{"1", "2"}));
+    ASSERT_TRUE(queue.empty());
+    ASSERT_FALSE(queue.queued(ZMQIdentity{"a"}));
+}
+
+TEST(OutboundQueueTests, BlockedPeerKeepsOrder)
+{
+    OutboundQueue queue{config(4)};
+    std::vector<std::string> sent;
+    size_t budget = 1;
+    /* "a" accepts budget messages, "b" is never blocked */
+    const auto trySend = [&sent, &budget](MDP::Message &message) {
+        if ("a" == message.get(0))
+        {
+            if (0 == budget) return false;
+            --budget;
+        }
+        sent.push_back(message.get(0) + message.get(1));
+        return true;
+    };
+
+    queue.push(ZMQIdentity{"a"}, message("a", "1"));
+    queue.push(ZMQIdentity{"a"}, message("a", "2"));
+    queue.push(ZMQIdentity{"a"}, message("a", "3"));
+    queue.push(ZMQIdentity{"b"}, message("b", "1"));
+
+    ASSERT_EQ(queue.drain(trySend), 2);
+    ASSERT_EQ(queue.size(), 2);
+    ASSERT_FALSE(queue.queued(ZMQIdentity{"b"}));
+
+    budget = 2;
+    ASSERT_EQ(queue.drain(trySend), 2);
+    ASSERT_TRUE(queue.empty());
+
+    std::vector<std::string> a;
+
+    for (const auto &s : sent)
+    {
+        if ('a' == s[0]) a.push_back(s);
+    }
+    ASSERT_EQ(a, (std::vector<std::string>{"a1", "a2", "a3"}));
+}
+
+TEST(OutboundQueueTests, RemoveDropsPeer)
+{
+    OutboundQueue queue{config(4)};
+
+    queue.push(ZMQIdentity{"a"}, message("a", "1"));
+    queue.push(ZMQIdentity{"a"}, message("a", "2"));
+    queue.push(ZMQIdentity{"b"}, message("b", "1"));
+
+    ASSERT_EQ(queue.remove(ZMQIdentity{"a"}), 2);
+    ASSERT_EQ(queue.remove(ZMQIdentity{"a"}), 0);
+    ASSERT_EQ(queue.size(), 1);
+    ASSERT_FALSE(queue.queued(ZMQIdentity{"a"}));
+    /* dropped peer accepts new messages */
+    ASSERT_TRUE(queue.push(ZMQIdentity{"a"}, message("a", "3")));
+}
+
+TEST(OutboundQueueTests, ZeroDepth)
+{
+    ASSERT_THROW(OutboundQueue{config(0)}, RuntimeError);
+}
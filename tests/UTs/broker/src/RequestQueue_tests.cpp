@@ -0,0 +1,182 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mdp/RequestQueue.h"
+
+using namespace std::chrono;
+
+using Clock     = RequestQueue::Clock;
+using TimePoint = RequestQueue::TimePoint;
+
+namespace {
+
+RequestQueue::Config config(size_t depth, milliseconds deadline = seconds{9})
+{
+    RequestQueue::Config config;
+
+    config.depth    = depth;
+    config.deadline = deadline;
+    return config;
+}
+
+void push(
+    RequestQueue &queue,
+    const std::string &serviceName,
+    const std::string &client,
+    TimePoint clientDeadline = TimePoint::max())
+{
+    queue.push(
+        serviceName, MDP::ClientAddress{ZMQIdentity{client}},
+        MDP::makeMessageHandle(), clientDeadline);
+}
+
+/* service:client of expired requests */
+std::vector<std::string> expire(RequestQueue &queue, TimePoint now)
+{
+    std::vector<std::string> expired;
+
+    queue.expire(
+        now, [&expired](const auto &serviceName, const auto &request) {
+            expired.push_back(
+                serviceName + ':'
+                + request.clientAddress_.identity_.asString());
+        });
+    return expired;
+}
+
+} /* namespace */
+
+TEST(RequestQueueTests, Disabled)
+{
+    RequestQueue queue{config(0)};
+
+    ASSERT_FALSE(queue.enabled());
+    ASSERT_TRUE(queue.full("echo"));
+    ASSERT_THROW(push(queue, "echo", "a"), FlowError);
+    ASSERT_FALSE(queue.deadline());
+}
+
+TEST(RequestQueueTests, DepthPerService)
+{
+    RequestQueue queue{config(2)};
+
+    push(queue, "echo", "a");
+    ASSERT_FALSE(queue.full("echo"));
+    push(queue, "echo", "b");
+    ASSERT_TRUE(queue.full("echo"));
+    ASSERT_THROW(push(queue, "echo", "c"), FlowError);
+
+    /* other service has own depth */
+    ASSERT_FALSE(queue.full("upper"));
+    push(queue, "upper", "c");
+    ASSERT_EQ(queue.size("echo"), 2);
+    ASSERT_EQ(queue.size("upper"), 1);
+
+    /* FIFO */
+    ASSERT_EQ(queue.front("echo").clientAddress_.identity_.asString(), "a");
+    ASSERT_EQ(queue.pop("echo").clientAddress_.identity_.asString(), "a");
+    ASSERT_FALSE(queue.full("echo"));
+    ASSERT_EQ(queue.pop("echo").clientAddress_.identity_.asString(), "b");
+    ASSERT_TRUE(queue.empty("echo"));
+    ASSERT_THROW(queue.pop("echo"), FlowError);
+}
+
+TEST(RequestQueueTests, ClientDeadlineBoundsWait)
+{
+    const auto now = Clock::now();
+    RequestQueue queue{config(4, milliseconds{50})};
+
+    push(queue, "echo", "a");
+    push(queue, "echo", "b", now + milliseconds{10});
+    push(queue, "echo", "c", now + hours{1});
+
+    /* b waits until its own deadline, a and c until queue deadline */
+    ASSERT_EQ(*queue.deadline(), now + milliseconds{10});
+    ASSERT_EQ(
+        expire(queue, now + milliseconds{10}),
+        std::vector<std::string>{"echo:b"});
+    ASSERT_LE(*queue.deadline(), Clock::now() + milliseconds{50});
+    ASSERT_EQ(
+        expire(queue, Clock::now() + milliseconds{50}),
+        (std::vector<std::string>{"echo:a", "echo:c"}));
+}
+
+TEST(RequestQueueTests, ExpiresInDeadlineOrder)
+{
+    const auto now = Clock::now();
+    RequestQueue queue{config(4)};
+
+    push(queue, "echo", "a", now + milliseconds{30});
+    push(queue, "echo", "b", now + milliseconds{10});
+    push(queue, "upper", "c", now + milliseconds{20});
+
+    ASSERT_TRUE(expire(queue, now).empty());
+    ASSERT_EQ(
+        expire(queue, now + milliseconds{20}),
+        (std::vector<std::string>{"echo:b", "upper:c"}));
+    ASSERT_TRUE(queue.empty("upper"));
+
+    /* FIFO order of remaining requests is kept */
+    ASSERT_EQ(queue.front("echo").clientAddress_.identity_.asString(), "a");
+    ASSERT_EQ(*queue.deadline(), now + milliseconds{30});
+    ASSERT_EQ(
+        expire(queue, now + milliseconds{30}),
+        std::vector<std::string>{"echo:a"});
+    ASSERT_FALSE(queue.deadline());
+}
+
+TEST(RequestQueueTests, PopRemovesFromExpiry)
+{
+    const auto now = Clock::now();
+    RequestQueue queue{config(4)};
+
+    /* equal deadlines - pop has to remove the right index entry */
+    push(queue, "echo", "a", now + milliseconds{10});
+    push(queue, "echo", "b", now + milliseconds{10});
+    push(queue, "echo", "c", now + milliseconds{20});
+
+    ASSERT_EQ(queue.pop("echo").clientAddress_.identity_.asString(), "a");
+    ASSERT_EQ(
+        expire(queue, now + milliseconds{10}),
+        std::vector<std::string>{"echo:b"});
+
+    ASSERT_EQ(queue.pop("echo").clientAddress_.identity_.asString(), "c");
+    ASSERT_FALSE(queue.deadline());
+    ASSERT_TRUE(expire(queue, now + hours{1}).empty());
+}
+
+TEST(RequestQueueTests, QueueDeadline)
+{
+    RequestQueue queue{config(4, milliseconds{10})};
+    const auto before = Clock::now();
+
+    push(queue, "echo", "a");
+
+    const auto after = Clock::now();
+
+    ASSERT_GE(*queue.deadline(), before + milliseconds{10});
+    ASSERT_LE(*queue.deadline(), after + milliseconds{10});
+    /* client deadline (none) is kept for dispatched request */
+    ASSERT_EQ(queue.front("echo").clientDeadline_, TimePoint::max());
+    ASSERT_EQ(
+        expire(queue, after + milliseconds{10}),
+        std::vector<std::string>{"echo:a"});
+}
+
+TEST(RequestQueueTests, PastClientDeadline)
+{
+    const auto now = Clock::now();
+    RequestQueue queue{config(4)};
+
+    /* client deadline passed before request was queued (e.g. zero ms
+     * deadline) - expires on next check */
+    push(queue, "echo", "a", now - milliseconds{1});
+    push(queue, "echo", "b");
+
+    ASSERT_LE(*queue.deadline(), now);
+    ASSERT_EQ(expire(queue, now), std::vector<std::string>{"echo:a"});
+    ASSERT_EQ(queue.front("echo").clientAddress_.identity_.asString(), "b");
+}
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "mdp/ResponseCache.h"
+
+using namespace std::chrono;
+
+using Payload = ResponseCache::Payload;
+
+namespace {
+
+ResponseCache::Config config(size_t capacity, size_t bytes = 1 << 20)
+{
+    ResponseCache::Config config;
+
+    config.capacity = capacity;
+    config.bytes    = bytes;
+    config.ttl      = milliseconds{10};
+    return config;
+}
+
+} /* namespace */
+
+TEST(ResponseCacheTests, EvictsLeastRecentlyUsed)
+{
+    const auto now = steady_clock::now();
+    ResponseCache cache{config(2)};
+
+    cache.insert("a", Payload{"1"}, now);
+    cache.insert("b", Payload{"2"}, now);
+    /* a is used after b */
+    ASSERT_NE(cache.find("a", now), nullptr);
+
+    cache.insert("c", Payload{"3"}, now);
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(cache.find("b", now), nullptr);
+    ASSERT_EQ(*cache.find("a", now), Payload{"1"});
+    ASSERT_EQ(*cache.find("c", now), Payload{"3"});
+    ASSERT_EQ(cache.hits(), 3);
+    ASSERT_EQ(cache.misses(), 1);
+}
+
+TEST(ResponseCacheTests, ExpiresAfterTtl)
+{
+    const auto now = steady_clock::now();
+    ResponseCache cache{config(2)};
+
+    cache.insert("a", Payload{"1"}, now);
+    ASSERT_NE(cache.find("a", now + milliseconds{9}), nullptr);
+    /* ttl counts from insert, not from last hit */
+    ASSERT_EQ(cache.find("a", now + milliseconds{10}), nullptr);
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_EQ(cache.bytes(), 0);
+
+    /* reinserted entry gets new ttl */
+    cache.insert("a", Payload{"2"}, now + milliseconds{10});
+    ASSERT_EQ(*cache.find("a", now + milliseconds{19}), Payload{"2"});
+}
+
+TEST(ResponseCacheTests, ReplacesSameKey)
+{
+    const auto now = steady_clock::now();
+    ResponseCache cache{config(2)};
+
+    cache.insert("a", Payload{"1"}, now);
+    cache.insert("b", Payload{"2"}, now);
+    /* replacement does not evict other entry */
+    cache.insert("a", Payload{"11"}, now);
+
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(cache.bytes(), 5);
+    ASSERT_EQ(*cache.find("a", now), Payload{"11"});
+    ASSERT_EQ(*cache.find("b", now), Payload{"2"});
+}
+
+TEST(ResponseCacheTests, EvictsByBytes)
+{
+    const auto now = steady_clock::now();
+    ResponseCache cache{config(16, 10)};
+
+    /* key and payload count */
+    cache.insert("a", Payload{"1234"}, now);
+    cache.insert("b", Payload{"12", "34"}, now);
+    ASSERT_EQ(cache.bytes(), 10);
+
+    cache.insert("c", Payload{"1"}, now);
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(cache.bytes(), 7);
+    ASSERT_EQ(cache.find("a", now), nullptr);
+
+    /* larger than whole cache - not cached, stale entry removed */
+    cache.insert("b", Payload{std::string(10, 'x')}, now);
+    ASSERT_EQ(cache.find("b", now), nullptr);
+    ASSERT_EQ(cache.size(), 1);
+    ASSERT_EQ(cache.bytes(), 2);
+}
+
+TEST(ResponseCacheTests, KeyViewsSurviveEviction)
+{
+    const auto now = steady_clock::now();
+    ResponseCache cache{config(1)};
+    std::string key(64, 'k');
+
+    /* map keys view strings owned by entries, not by caller */
+    cache.insert(key, Payload{"1"}, now);
+    key.assign(64, 'x');
+    ASSERT_EQ(cache.find(key, now), nullptr);
+    ASSERT_NE(cache.find(std::string(64, 'k'), now), nullptr);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        cache.insert(std::to_string(i), Payload{"v"}, now);
+        ASSERT_EQ(*cache.find(std::to_string(i), now), Payload{"v"});
+    }
+    ASSERT_EQ(cache.size(), 1);
+}
+
+TEST(ResponseCacheTests, KeyKeepsFrameBoundaries)
+{
+    zmqpp::message ab;
+    zmqpp::message a_b;
+
+    ab.add("ab");
+    a_b.add("a");
+    a_b.add("b");
+
+    ASSERT_NE(ResponseCache::key(ab, 0), ResponseCache::key(a_b, 0));
+    ASSERT_EQ(
+        ResponseCache::key(a_b, 1), ResponseCache::key(zmqpp::message{"b"}, 0));
+}
@@ -0,0 +1,150 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mdp/WorkerPool.h"
+
+using namespace std::chrono;
+
+using Task = WorkerPool::Worker::Task;
+using TimePoint = Task::TimePoint;
+
+namespace {
+
+MDP::ClientAddress address(const std::string &id)
+{
+    return MDP::ClientAddress{ZMQIdentity{id}};
+}
+
+std::vector<std::string> expire(Task &task, TimePoint now)
+{
+    std::vector<std::string> expired;
+    task.expire(now, [&expired](const MDP::ClientAddress &clientAddress) {
+        expired.push_back(clientAddress.identity_.asString());
+    });
+    return expired;
+}
+
+Task leader(TimePoint now, TimePoint deadline)
+{
+    return Task{address("leader"), now, deadline};
+}
+
+} /* namespace */
+
+TEST(WorkerPoolTaskTests, LeaderOnly)
+{
+    const auto now = steady_clock::now();
+    auto task = leader(now, now + milliseconds{10});
+
+    ASSERT_TRUE(task.waiting());
+    ASSERT_EQ(task.clients(), 1);
+    ASSERT_TRUE(expire(task, now).empty());
+    ASSERT_EQ(expire(task, now + milliseconds{10}),
+              std::vector<std::string>{"leader"});
+    ASSERT_TRUE(task.expired_);
+    ASSERT_FALSE(task.waiting());
+    ASSERT_EQ(task.clients(), 0);
+    /* expired once */
+    ASSERT_TRUE(expire(task, now + milliseconds{20}).empty());
+}
+
+TEST(WorkerPoolTaskTests, FollowerOutlivesLeaderDeadline)
+{
+    const auto now = steady_clock::now();
+    auto task = leader(now, now + milliseconds{10});
+
+    task.coalesced_.push_back({address("later"), now + milliseconds{30}});
+    task.coalesced_.push_back({address("none"), TimePoint::max()});
+    ASSERT_EQ(task.clients(), 3);
+
+    ASSERT_EQ(expire(task, now + milliseconds{10}),
+              std::vector<std::string>{"leader"});
+    /* followers still wait for worker reply */
+    ASSERT_TRUE(task.waiting());
+    ASSERT_EQ(task.clients(), 2);
+
+    ASSERT_EQ(expire(task, now + milliseconds{30}),
+              std::vector<std::string>{"later"});
+    ASSERT_TRUE(task.waiting());
+    ASSERT_EQ(task.clients(), 1);
+    ASSERT_EQ(task.coalesced_.front().clientAddress_.identity_.asString(),
+              "none");
+}
+
+TEST(WorkerPoolTaskTests, EarlierFollowerExpiresFirst)
+{
+    const auto now = steady_clock::now();
+    auto task = leader(now, now + milliseconds{30});
+
+    task.coalesced_.push_back({address("a"), now + milliseconds{20}});
+    task.coalesced_.push_back({address("b"), now + milliseconds{10}});
+    task.coalesced_.push_back({address("c"), now + milliseconds{40}});
+
+    ASSERT_EQ(expire(task, now + milliseconds{10}),
+              std::vector<std::string>{"b"});
+    ASSERT_FALSE(task.expired_);
+    ASSERT_EQ(task.clients(), 3);
+
+    /* followers keep their attach order */
+    ASSERT_EQ(task.coalesced_[0].clientAddress_.identity_.asString(), "a");
+    ASSERT_EQ(task.coalesced_[1].clientAddress_.identity_.asString(), "c");
+
+    ASSERT_EQ(expire(task, now + milliseconds{30}),
+              (std::vector<std::string>{"leader", "a"}));
+    ASSERT_EQ(task.clients(), 1);
+
+    ASSERT_EQ(expire(task, now + milliseconds{40}),
+              std::vector<std::string>{"c"});
+    ASSERT_FALSE(task.waiting());
+}
+
+TEST(WorkerPoolTaskTests, RepliesCountFollowers)
+{
+    const auto now = steady_clock::now();
+    auto task = leader(now, TimePoint::max());
+
+    task.coalesced_.push_back({address("a"), TimePoint::max()});
+    task.coalesced_.push_back({address("b"), TimePoint::max()});
+
+    /* no deadline - never expires */
+    ASSERT_TRUE(expire(task, now + hours{24}).empty());
+    /* every attached client gets (and counts as) a reply */
+    ASSERT_EQ(task.clients(), 3);
+
+    task.expired_ = true;
+    ASSERT_TRUE(task.waiting());
+    ASSERT_EQ(task.clients(), 2);
+}
+
+TEST(WorkerPoolTests, AcquireChunked)
+{
+    WorkerPool pool;
+
+    pool.append("store", ZMQIdentity{"plain"});
+    ASSERT_FALSE(pool.chunked("store"));
+    ASSERT_EQ(pool.acquire("store", true), nullptr);
+
+    pool.append("store", ZMQIdentity{"chunked"});
+    pool.findWorker(ZMQIdentity{"chunked"})->chunked_ = true;
+    ASSERT_TRUE(pool.chunked("store"));
+    ASSERT_FALSE(pool.chunked("other"));
+
+    /* least recently used worker which accepts chunked request */
+    auto *worker = pool.acquire("store", true);
+
+    ASSERT_NE(worker, nullptr);
+    ASSERT_EQ(worker->identity_.asString(), "chunked");
+    /* chunked worker busy, plain one is idle */
+    ASSERT_EQ(pool.acquire("store", true), nullptr);
+
+    auto *plain = pool.acquire("store");
+
+    ASSERT_NE(plain, nullptr);
+    ASSERT_EQ(plain->identity_.asString(), "plain");
+
+    pool.release(*worker);
+    ASSERT_EQ(pool.acquire("store", true), worker);
+}
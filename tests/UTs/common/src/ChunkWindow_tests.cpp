@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "mdp/ChunkWindow.h"
+
+TEST(ChunkWindowTests, FirstChunkWaitsForWorker)
+{
+    ChunkWindow window{4};
+
+    ASSERT_TRUE(window.open());
+    ASSERT_EQ(window.next(), 0);
+
+    window.sent();
+    /* chunk 1 waits until chunk 0 is accepted (worker assigned) */
+    ASSERT_FALSE(window.open());
+    ASSERT_EQ(window.unaccepted(), 1);
+    ASSERT_THROW(window.sent(), FlowError);
+
+    window.accepted();
+    ASSERT_TRUE(window.open());
+    ASSERT_EQ(window.next(), 1);
+    ASSERT_EQ(window.unaccepted(), 0);
+}
+
+TEST(ChunkWindowTests, WindowBoundsUnaccepted)
+{
+    ChunkWindow window{4};
+
+    window.sent();
+    window.accepted();
+
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(window.open());
+        window.sent();
+    }
+    ASSERT_FALSE(window.open());
+    ASSERT_EQ(window.unaccepted(), 4);
+    ASSERT_EQ(window.next(), 5);
+
+    /* each accept lets one more chunk in */
+    window.accepted();
+    ASSERT_TRUE(window.open());
+    window.sent();
+    ASSERT_FALSE(window.open());
+
+    for (int i = 0; i < 4; ++i) window.accepted();
+    ASSERT_EQ(window.unaccepted(), 0);
+    ASSERT_TRUE(window.open());
+    ASSERT_EQ(window.next(), 6);
+}
+
+TEST(ChunkWindowTests, AcceptOfChunkNotSent)
+{
+    ChunkWindow window{1};
+
+    ASSERT_THROW(window.accepted(), FlowError);
+
+    window.sent();
+    window.accepted();
+    ASSERT_THROW(window.accepted(), FlowError);
+
+    window.sent();
+    /* window of 1 - lock step */
+    ASSERT_FALSE(window.open());
+}
+
+TEST(ChunkWindowTests, DefaultWindow)
+{
+    ChunkWindow window;
+
+    window.sent();
+    window.accepted();
+
+    for (size_t i = 0; i < MDP::Client::chunkWindow; ++i) window.sent();
+    ASSERT_FALSE(window.open());
+    ASSERT_THROW(ChunkWindow{0}, RuntimeError);
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "mdp/FastTrace.h"
+
+TEST(FastTraceTests, RecordFormattedByWriter)
+{
+    std::ostringstream os;
+
+    {
+        FastTrace::Writer writer{os};
+
+        FastTrace::setLevel(FastTrace::Level::Debug);
+        FAST_TRACE(Debug, "client req", ZMQIdentity{"client"}, 6u);
+        /* above runtime threshold */
+        FAST_TRACE(Trace, "heartbeat", ZMQIdentity{"worker"});
+        FastTrace::setLevel(FastTrace::Level::Info);
+    }
+
+    const auto str = os.str();
+
+    ASSERT_NE(str.find("D client req client 6\n"), std::string::npos);
+    ASSERT_EQ(str.find("heartbeat"), std::string::npos);
+}
+
+TEST(FastTraceTests, SingleWriter)
+{
+    std::ostringstream os;
+    FastTrace::Writer writer{os};
+
+    ASSERT_THROW(FastTrace::Writer{os}, RuntimeError);
+}
+
+TEST(FastTraceTests, TextKeepsTail)
+{
+    FastTrace::Record record;
+
+    record.textSize_ = 0;
+    FastTrace::put(
+        record, std::string(FastTrace::Record::textCapacity, 'x') + "#1");
+
+    ASSERT_EQ(record.textSize_, FastTrace::Record::textCapacity);
+    ASSERT_EQ(record.text_[record.textSize_ - 1], '1');
+    ASSERT_EQ(record.text_[record.textSize_ - 2], '#');
+}
+
+TEST(FastTraceTests, DroppedRecordsReported)
+{
+    std::ostringstream os;
+
+    {
+        FastTrace::Writer writer{os};
+
+        /* ring full */
+        FastTrace::drop();
+        FastTrace::drop();
+    }
+
+    ASSERT_NE(os.str().find("2 records dropped\n"), std::string::npos);
+}
+
+TEST(FastTraceTests, WrittenWithoutWriter)
+{
+    std::ostringstream os;
+    auto *const buf = std::clog.rdbuf(os.rdbuf());
+
+    FastTrace::setLevel(FastTrace::Level::Debug);
+    FAST_TRACE(Debug, "no writer", 7u);
+    FastTrace::setLevel(FastTrace::Level::Info);
+    std::clog.rdbuf(buf);
+
+    ASSERT_NE(os.str().find("D no writer 7\n"), std::string::npos);
+}
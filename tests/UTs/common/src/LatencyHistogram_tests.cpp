@@ -0,0 +1,70 @@
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include "mdp/LatencyHistogram.h"
+
+using namespace std::chrono;
+
+TEST(LatencyHistogramTests, Empty)
+{
+    LatencyHistogram histogram;
+
+    ASSERT_EQ(histogram.count(), 0);
+    ASSERT_EQ(histogram.percentile(0.5), microseconds{0});
+    ASSERT_EQ(histogram.min(), microseconds{0});
+    ASSERT_EQ(histogram.max(), microseconds{0});
+}
+
+TEST(LatencyHistogramTests, SmallValuesExact)
+{
+    LatencyHistogram histogram;
+
+    for (int i = 1; i <= 50; ++i) histogram.record(microseconds{i});
+
+    ASSERT_EQ(histogram.count(), 50);
+    ASSERT_EQ(histogram.min(), microseconds{1});
+    ASSERT_EQ(histogram.max(), microseconds{50});
+    ASSERT_EQ(histogram.percentile(0.5), microseconds{25});
+    ASSERT_EQ(histogram.percentile(0.99), microseconds{50});
+    ASSERT_EQ(histogram.percentile(1.0), microseconds{50});
+}
+
+TEST(LatencyHistogramTests, RelativePrecision)
+{
+    LatencyHistogram histogram;
+
+    for (int i = 1; i <= 100000; ++i) histogram.record(microseconds{i});
+
+    const auto check = [&](double q) {
+        const auto expected = q * 100000;
+        const auto actual   = double(histogram.percentile(q).count());
+
+        ASSERT_GE(actual, expected);
+        ASSERT_LE(actual, expected * (1.0 + 1.0 / 32));
+    };
+
+    check(0.5);
+    check(0.99);
+    check(0.999);
+    ASSERT_EQ(histogram.percentile(1.0), microseconds{100000});
+    ASSERT_EQ(histogram.mean(), microseconds{50000});
+}
+
+TEST(LatencyHistogramTests, Merge)
+{
+    LatencyHistogram x;
+    LatencyHistogram y;
+
+    x.record(microseconds{10});
+    y.record(microseconds{1000000});
+    x.merge(y);
+
+    ASSERT_EQ(x.count(), 2);
+    ASSERT_EQ(x.min(), microseconds{10});
+    ASSERT_EQ(x.max(), microseconds{1000000});
+    ASSERT_EQ(x.percentile(0.5), microseconds{10});
+
+    x.reset();
+    ASSERT_EQ(x.count(), 0);
+}
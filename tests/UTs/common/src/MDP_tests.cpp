@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include "mdp/MDP.h"
+
+TEST(MDPTest, Prepend)
+{
+    auto msg = MDP::makeMessage(std::string{"body"});
+
+    MDP::prepend(msg, ZMQIdentity{"id"}, MDP::EmptyFrame{}, "sig");
+
+    ASSERT_EQ(msg.parts(), 4);
+    ASSERT_EQ(msg.get(0), "id");
+    ASSERT_EQ(msg.size(1), 0);
+    ASSERT_EQ(msg.get(2), "sig");
+    ASSERT_EQ(msg.get(3), "body");
+}
+
+TEST(MDPTest, ToWorkerReq)
+{
+    auto msg = MDP::makeMessage(
+        ZMQIdentity{"client"}, MDP::EmptyFrame{}, MDP::Client::Signature::self,
+        std::string{"echo"}, std::string{"a"}, std::string{"b"});
+
+    const auto address = MDP::Broker::clientAddress(msg);
+
+    ASSERT_EQ(address.frames(), 1);
+    MDP::Broker::toWorkerReq(msg, address, ZMQIdentity{"worker"});
+
+    ASSERT_EQ(msg.parts(), 8);
+    ASSERT_EQ(msg.get(0), "worker");
+    ASSERT_EQ(msg.size(1), 0);
+    ASSERT_EQ(msg.get(2), MDP::Worker::Signature::self);
+    ASSERT_EQ(msg.get(3), MDP::Worker::Signature::request);
+    ASSERT_EQ(msg.get(4), "client");
+    ASSERT_EQ(msg.size(5), 0);
+    ASSERT_EQ(msg.get(6), "a");
+    ASSERT_EQ(msg.get(7), "b");
+}
+
+TEST(MDPTest, ToWorkerChunk)
+{
+    auto msg = MDP::Client::makeChunk("echo", 1, true, std::string{"a"});
+
+    MDP::prepend(msg, ZMQIdentity{"client"});
+
+    const auto address = MDP::Broker::clientAddress(msg);
+
+    ASSERT_EQ(msg.get(2), MDP::Client::Signature::chunk);
+    MDP::Broker::toWorkerChunk(msg, address, ZMQIdentity{"worker"});
+
+    ASSERT_EQ(msg.parts(), 9);
+    ASSERT_EQ(msg.get(0), "worker");
+    ASSERT_EQ(msg.size(1), 0);
+    ASSERT_EQ(msg.get(2), MDP::Worker::Signature::self);
+    ASSERT_EQ(msg.get(3), MDP::Worker::Signature::chunk);
+    ASSERT_EQ(msg.get(4), "client");
+    ASSERT_EQ(msg.size(5), 0);
+    ASSERT_EQ(msg.get(6), "1");
+    ASSERT_EQ(msg.get(7), MDP::Client::Signature::last);
+    ASSERT_EQ(msg.get(8), "a");
+}
+
+TEST(MDPTest, ToSucessClientRep)
+{
+    auto msg = MDP::makeMessage(
+        ZMQIdentity{"worker"}, MDP::EmptyFrame{}, MDP::Worker::Signature::self,
+        MDP::Worker::Signature::reply, ZMQIdentity{"client"},
+        MDP::EmptyFrame{}, std::string{"a"});
+
+    MDP::Broker::toSucessClientRep(msg, ZMQIdentity{"client"}, "echo");
+
+    ASSERT_EQ(msg.parts(), 6);
+    ASSERT_EQ(msg.get(0), "client");
+    ASSERT_EQ(msg.size(1), 0);
+    ASSERT_EQ(msg.get(2), MDP::Client::Signature::self);
+    ASSERT_EQ(msg.get(3), "echo");
+    ASSERT_EQ(msg.get(4), MDP::Broker::Signature::statusSucess);
+    ASSERT_EQ(msg.get(5), "a");
+}
+
+TEST(MDPTest, ToPartialClientRep)
+{
+    /* as received by broker ROUTER socket */
+    auto msg = MDP::Worker::makePartial(ZMQIdentity{"client"}, "a");
+
+    MDP::prepend(msg, ZMQIdentity{"worker"});
+    ASSERT_EQ(msg.get(3), MDP::Worker::Signature::partial);
+
+    MDP::Broker::toPartialClientRep(msg, ZMQIdentity{"client"}, "echo");
+
+    ASSERT_EQ(msg.parts(), 6);
+    ASSERT_EQ(msg.get(0), "client");
+    ASSERT_EQ(msg.size(1), 0);
+    ASSERT_EQ(msg.get(2), MDP::Client::Signature::self);
+    ASSERT_EQ(msg.get(3), "echo");
+    ASSERT_EQ(msg.get(4), MDP::Broker::Signature::statusPartial);
+    ASSERT_EQ(msg.get(5), "a");
+}
+
+TEST(MDPTest, ConversionFormatInvalid)
+{
+    auto msg = MDP::makeMessage(ZMQIdentity{"client"}, MDP::EmptyFrame{});
+
+    ASSERT_THROW(
+        MDP::Broker::toWorkerReq(
+            msg, ZMQIdentity{"client"}, ZMQIdentity{"worker"}),
+        MessageFormatInvalid);
+    ASSERT_THROW(
+        MDP::Broker::toSucessClientRep(msg, ZMQIdentity{"client"}, "echo"),
+        MessageFormatInvalid);
+}
+
+TEST(MDPTest, RequestId)
+{
+    /* as received by broker ROUTER socket */
+    auto msg = MDP::Client::makeReqWithId("7", "echo", std::string{"a"});
+
+    MDP::prepend(msg, ZMQIdentity{"client"});
+
+    const auto address = MDP::Broker::clientAddress(msg);
+
+    ASSERT_EQ(address.identity_.asString(), "client");
+    ASSERT_EQ(address.requestId_, "7");
+    ASSERT_EQ(address.frames(), 2);
+
+    MDP::Broker::toWorkerReq(msg, address, ZMQIdentity{"worker"});
+
+    ASSERT_EQ(msg.parts(), 7);
+    ASSERT_EQ(msg.get(4), address.key());
+    ASSERT_EQ(msg.get(6), "a");
+
+    auto rep = MDP::makeMessage(
+        ZMQIdentity{"worker"}, MDP::EmptyFrame{}, MDP::Worker::Signature::self,
+        MDP::Worker::Signature::reply, ZMQIdentity{"client"},
+        MDP::EmptyFrame{}, std::string{"b"});
+
+    MDP::Broker::toSucessClientRep(rep, address, "echo");
+
+    ASSERT_EQ(rep.parts(), 7);
+    ASSERT_EQ(rep.get(0), "client");
+    ASSERT_EQ(rep.get(1), "7");
+    ASSERT_EQ(rep.size(2), 0);
+    ASSERT_EQ(rep.get(3), MDP::Client::Signature::self);
+    ASSERT_EQ(rep.get(6), "b");
+}
+
+TEST(MDPTest, ClientAddressKey)
+{
+    const MDP::ClientAddress x{ZMQIdentity{"ab"}, "c1"};
+    const MDP::ClientAddress y{ZMQIdentity{"abc"}, "1"};
+    const MDP::ClientAddress z{ZMQIdentity{"ab"}, "c2"};
+
+    ASSERT_EQ(MDP::ClientAddress{ZMQIdentity{"ab"}}.key(), "ab");
+    ASSERT_NE(x.key(), y.key());
+    ASSERT_NE(x.key(), z.key());
+}
+
+TEST(MDPTest, ReadyProperty)
+{
+    auto msg = MDP::Worker::makeReady(
+        "echo", MDP::Worker::makeProperty(MDP::Worker::Property::credits, "4"));
+
+    MDP::prepend(msg, ZMQIdentity{"worker"});
+
+    ASSERT_EQ(msg.parts(), 6);
+    ASSERT_EQ(msg.get(4), "echo");
+    ASSERT_EQ(
+        MDP::Broker::readyProperty(msg, MDP::Worker::Property::credits), "4");
+    ASSERT_EQ(MDP::Broker::readyProperty(msg, "other"), "");
+}
+
+TEST(MDPTest, Deadline)
+{
+    using namespace std::chrono_literals;
+
+    /* as received by broker ROUTER socket */
+    auto msg = MDP::Client::makeReqWithDeadline(
+        "7", "echo", 250ms, std::string{"a"});
+
+    MDP::prepend(msg, ZMQIdentity{"client"});
+
+    ASSERT_EQ(msg.parts(), 7);
+    ASSERT_EQ(MDP::Broker::takeDeadline(msg), 250ms);
+    /* deadline frame removed */
+    ASSERT_EQ(msg.parts(), 6);
+    ASSERT_EQ(msg.get(4), "echo");
+    ASSERT_EQ(msg.get(5), "a");
+
+    auto plain = MDP::Client::makeReqWithId("7", "echo", std::string{"1"});
+
+    MDP::prepend(plain, ZMQIdentity{"client"});
+
+    ASSERT_EQ(MDP::Broker::takeDeadline(plain), 0ms);
+    ASSERT_EQ(plain.parts(), 6);
+
+    /* 0 - no deadline, frame is removed anyway */
+    auto zero = MDP::Client::makeReqWithDeadline("7", "echo", 0ms);
+
+    MDP::prepend(zero, ZMQIdentity{"client"});
+    ASSERT_EQ(MDP::Broker::takeDeadline(zero), 0ms);
+    ASSERT_EQ(zero.parts(), 5);
+}
@@ -0,0 +1,41 @@
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mdp/MPSCRing.h"
+
+TEST(MPSCRingTests, MultipleProducers)
+{
+    constexpr int producers = 4;
+    constexpr int num       = 10000;
+
+    MPSCRing<int> ring{64};
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&ring, p]() {
+            for (int i = 0; i < num; ++i)
+                while (!ring.push(p * num + i)) std::this_thread::yield();
+        });
+    }
+
+    /* every value received once, per producer in order */
+    std::vector<int> next(producers, 0);
+    int value = 0;
+
+    for (int received = 0; received < producers * num;)
+    {
+        if (!ring.pop(value)) continue;
+
+        const auto p = value / num;
+
+        ASSERT_EQ(value % num, next[p]);
+        ++next[p];
+        ++received;
+    }
+
+    for (auto &thread : threads) thread.join();
+    ASSERT_FALSE(ring.pop(value));
+}
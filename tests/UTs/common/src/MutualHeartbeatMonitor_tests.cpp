@@ -78,3 +78,42 @@ TEST(MutualHeartbeatMonitorTests, Reset)
     ASSERT_TRUE(monitor.peerHeartbeatExpired());
     ASSERT_TRUE(monitor.shouldHeartbeat());
 }
+
+TEST(MutualHeartbeatMonitorTests, Deadlines)
+{
+    MutualHeartbeatMonitor monitor{milliseconds{100}};
+
+    ASSERT_EQ(
+        monitor.peerDeadline() - monitor.selfDeadline(),
+        2 * monitor.period());
+    ASSERT_EQ(monitor.deadline(), monitor.selfDeadline());
+
+    const auto self = monitor.selfDeadline();
+
+    ASSERT_FALSE(monitor.shouldHeartbeat(self - milliseconds{1}));
+    ASSERT_TRUE(monitor.shouldHeartbeat(self));
+
+    const auto peer = monitor.peerDeadline();
+
+    ASSERT_FALSE(monitor.peerHeartbeatExpired(peer - milliseconds{1}));
+    ASSERT_TRUE(monitor.peerHeartbeatExpired(peer));
+}
+
+TEST(MutualHeartbeatMonitorTests, Liveness)
+{
+    MutualHeartbeatMonitor monitor{milliseconds{100}, 5};
+
+    ASSERT_EQ(monitor.liveness(), 5);
+    ASSERT_EQ(
+        monitor.peerDeadline() - monitor.selfDeadline(),
+        4 * monitor.period());
+
+    const auto self = monitor.selfDeadline() - monitor.period();
+
+    /* timestamps are kept */
+    monitor.configure(milliseconds{20}, 2);
+
+    ASSERT_EQ(monitor.period(), milliseconds{20});
+    ASSERT_EQ(monitor.selfDeadline(), self + milliseconds{20});
+    ASSERT_EQ(monitor.peerDeadline(), self + milliseconds{40});
+}
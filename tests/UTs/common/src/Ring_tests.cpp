@@ -0,0 +1,73 @@
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "mdp/MPSCRing.h"
+#include "mdp/SPSCRing.h"
+
+/* cases shared by both rings (single producer, single consumer) */
+template <typename Ring>
+class RingTests : public ::testing::Test
+{ };
+
+using Rings = ::testing::Types<MPSCRing<int>, SPSCRing<int>>;
+
+TYPED_TEST_SUITE(RingTests, Rings);
+
+TYPED_TEST(RingTests, CapacityPowerOf2)
+{
+    ASSERT_THROW(TypeParam{3}, RuntimeError);
+    ASSERT_THROW(TypeParam{1}, RuntimeError);
+    ASSERT_EQ(TypeParam{4}.capacity(), 4);
+}
+
+TYPED_TEST(RingTests, PushPopFull)
+{
+    TypeParam ring{4};
+    int value = 0;
+
+    ASSERT_FALSE(ring.pop(value));
+
+    for (int i = 0; i < 4; ++i) ASSERT_TRUE(ring.push(int{i}));
+    ASSERT_FALSE(ring.push(4));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(ring.pop(value));
+        ASSERT_EQ(value, i);
+    }
+    ASSERT_FALSE(ring.pop(value));
+    /* wrap around */
+    ASSERT_TRUE(ring.push(5));
+    ASSERT_TRUE(ring.pop(value));
+    ASSERT_EQ(value, 5);
+}
+
+TYPED_TEST(RingTests, ProducerConsumer)
+{
+    constexpr int num = 100000;
+
+    TypeParam ring{64};
+    std::thread producer{[&ring]() {
+        for (int i = 0; i < num; ++i)
+            while (!ring.push(int{i})) std::this_thread::yield();
+    }};
+
+    /* every value received once, in order */
+    int value = 0;
+
+    for (int next = 0; next < num;)
+    {
+        if (!ring.pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ASSERT_EQ(value, next);
+        ++next;
+    }
+
+    producer.join();
+    ASSERT_FALSE(ring.pop(value));
+}
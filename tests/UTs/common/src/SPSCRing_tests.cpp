@@ -0,0 +1,75 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "mdp/SPSCRing.h"
+
+/* shared ring cases are in Ring_tests.cpp */
+
+TEST(SPSCRingTests, MoveOnlyValueKeptIfFull)
+{
+    SPSCRing<std::unique_ptr<int>> ring{2};
+    std::unique_ptr<int> value;
+
+    ASSERT_TRUE(ring.push(std::make_unique<int>(0)));
+    ASSERT_TRUE(ring.push(std::make_unique<int>(1)));
+    ASSERT_TRUE(ring.full());
+
+    /* value is not moved from if ring is full */
+    auto last = std::make_unique<int>(2);
+
+    ASSERT_FALSE(ring.push(std::move(last)));
+    ASSERT_TRUE(last);
+
+    ASSERT_TRUE(ring.pop(value));
+    ASSERT_EQ(*value, 0);
+    ASSERT_FALSE(ring.full());
+    ASSERT_TRUE(ring.push(std::move(last)));
+    ASSERT_FALSE(last);
+}
+
+TEST(SPSCRingTests, ConcurrentWrapAround)
+{
+    /* smallest ring - counters wrap every other value, producer keeps
+     * hitting full ring while consumer pops */
+    constexpr size_t num = 20000;
+
+    SPSCRing<std::unique_ptr<size_t>> ring{2};
+    std::atomic<size_t> fullSeen{0};
+    std::thread producer{[&ring, &fullSeen]() {
+        for (size_t i = 0; i < num; ++i)
+        {
+            auto value = std::make_unique<size_t>(i);
+
+            while (!ring.push(std::move(value)))
+            {
+                /* failed push leaves value for retry */
+                ASSERT_TRUE(value);
+                ++fullSeen;
+                std::this_thread::yield();
+            }
+        }
+    }};
+
+    std::unique_ptr<size_t> value;
+
+    for (size_t next = 0; next < num;)
+    {
+        if (!ring.pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ASSERT_TRUE(value);
+        ASSERT_EQ(*value, next);
+        ++next;
+    }
+
+    producer.join();
+    ASSERT_FALSE(ring.pop(value));
+    ASSERT_FALSE(ring.full());
+    ASSERT_LT(0, fullSeen.load());
+}
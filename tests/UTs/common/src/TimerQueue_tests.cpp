@@ -0,0 +1,119 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mdp/TimerQueue.h"
+
+using namespace std::chrono;
+
+using Queue = TimerQueue<std::string>;
+
+TEST(TimerQueueTests, Empty)
+{
+    Queue queue;
+    const auto now = Queue::Clock::now();
+
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(queue.expire(now, [](std::string, Queue::TimePoint) {}), 0);
+    ASSERT_EQ(queue.timeout(now, milliseconds{100}), milliseconds{100});
+}
+
+TEST(TimerQueueTests, ExpireInDeadlineOrder)
+{
+    Queue queue;
+    const auto now = Queue::Clock::now();
+
+    queue.schedule(now + milliseconds{30}, "c");
+    queue.schedule(now + milliseconds{10}, "a");
+    queue.schedule(now + milliseconds{50}, "e");
+    queue.schedule(now + milliseconds{20}, "b");
+
+    ASSERT_EQ(queue.size(), 4);
+    ASSERT_EQ(queue.deadline(), now + milliseconds{10});
+
+    std::vector<std::string> expired;
+    const auto num = queue.expire(
+        now + milliseconds{30},
+        [&](std::string key, Queue::TimePoint) { expired.push_back(key); });
+
+    ASSERT_EQ(num, 3);
+    ASSERT_EQ(expired, (std::vector<std::string>{"a", "b", "c"}));
+    ASSERT_EQ(queue.size(), 1);
+    ASSERT_EQ(queue.deadline(), now + milliseconds{50});
+}
+
+TEST(TimerQueueTests, Reschedule)
+{
+    Queue queue;
+    const auto now    = Queue::Clock::now();
+    const auto period = milliseconds{10};
+
+    queue.schedule(now + period, "periodic");
+
+    for (int i = 1; i < 4; ++i)
+    {
+        const auto t = now + i * period;
+        const auto num
+            = queue.expire(t, [&](std::string key, Queue::TimePoint deadline) {
+                  ASSERT_EQ(deadline, t);
+                  queue.schedule(t + period, std::move(key));
+              });
+
+        ASSERT_EQ(num, 1);
+        ASSERT_EQ(queue.size(), 1);
+        ASSERT_EQ(queue.deadline(), t + period);
+    }
+}
+
+TEST(TimerQueueTests, Timeout)
+{
+    Queue queue;
+    const auto now = Queue::Clock::now();
+
+    queue.schedule(now + microseconds{1500}, "x");
+
+    ASSERT_EQ(queue.timeout(now, milliseconds{100}), milliseconds{2});
+    ASSERT_EQ(queue.timeout(now, milliseconds{1}), milliseconds{1});
+    ASSERT_EQ(
+        queue.timeout(now + milliseconds{2}, milliseconds{100}),
+        milliseconds{0});
+}
+
+TEST(TimerQueueTests, PurgeKeepsHeapOrder)
+{
+    Queue queue;
+    const auto now = Queue::Clock::now();
+
+    for (int i = 0; i < 10; ++i)
+        queue.schedule(now + milliseconds{10 - i}, std::to_string(i));
+
+    /* odd keys are stale */
+    const auto num = queue.purge([](const std::string &key, Queue::TimePoint) {
+        return 1 == std::stoi(key) % 2;
+    });
+
+    ASSERT_EQ(num, 5);
+    ASSERT_EQ(queue.size(), 5);
+    ASSERT_EQ(queue.deadline(), now + milliseconds{2});
+
+    std::vector<std::string> expired;
+
+    queue.expire(now + milliseconds{10}, [&](std::string key, auto) {
+        expired.push_back(key);
+    });
+    ASSERT_EQ(expired, (std::vector<std::string>{"8", "6", "4", "2", "0"}));
+}
+
+TEST(TimerQueueTests, PurgeNone)
+{
+    Queue queue;
+    const auto now = Queue::Clock::now();
+
+    queue.schedule(now, "a");
+    ASSERT_EQ(queue.purge([](const auto &, auto) { return false; }), 0);
+    ASSERT_EQ(queue.size(), 1);
+    ASSERT_EQ(queue.purge([](const auto &, auto) { return true; }), 1);
+    ASSERT_TRUE(queue.empty());
+}
@@ -1,4 +1,5 @@
 #include <map>
+#include <unordered_set>
 
 #include <gtest/gtest.h>
 
@@ -51,3 +52,19 @@ TEST(ZMQIdentityTest, Uniqueness)
     for (int i = 0; i < 1000; ++i)
         ASSERT_TRUE(all.insert(ZMQIdentity::unique()).second);
 }
+
+TEST(ZMQIdentityTest, Hash)
+{
+    std::unordered_set<ZMQIdentity> all;
+
+    ASSERT_EQ(std::hash<ZMQIdentity>{}(ZMQIdentity{"a"}),
+              std::hash<ZMQIdentity>{}(ZMQIdentity{"a"}));
+
+    for (int i = 0; i < 1000; ++i)
+        ASSERT_TRUE(all.insert(ZMQIdentity::unique()).second);
+
+    ASSERT_EQ(all.size(), 1000);
+
+    for (const auto &id : all)
+        ASSERT_EQ(all.count(ZMQIdentity{id.asString()}), 1);
+}
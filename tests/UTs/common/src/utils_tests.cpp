@@ -1,3 +1,6 @@
+#include <limits>
+#include <string>
+
 #include <gtest/gtest.h>
 
 #include "mdp/utils.h"
@@ -38,3 +41,21 @@ TEST(UtilsTest, AsHex)
 
     EXPECT_STREQ(asHex(seq256, seq256 + 256).c_str(), expected256.c_str());
 }
+
+TEST(UtilsTest, ParseNumber)
+{
+    EXPECT_EQ(parseNumber("0"), size_t{0});
+    EXPECT_EQ(parseNumber("3000"), size_t{3000});
+    const auto max = std::numeric_limits<size_t>::max();
+
+    EXPECT_EQ(parseNumber(std::to_string(max)), max);
+
+    EXPECT_FALSE(parseNumber(""));
+    EXPECT_FALSE(parseNumber("-1"));
+    EXPECT_FALSE(parseNumber("+1"));
+    EXPECT_FALSE(parseNumber(" 1"));
+    EXPECT_FALSE(parseNumber("1 "));
+    EXPECT_FALSE(parseNumber("1k"));
+    EXPECT_FALSE(parseNumber("0x10"));
+    EXPECT_FALSE(parseNumber(std::to_string(max) + '0'));
+}
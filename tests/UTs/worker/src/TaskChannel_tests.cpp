@@ -0,0 +1,62 @@
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "mdp/EventFd.h"
+#include "mdp/SPSCRing.h"
+
+using namespace std::chrono;
+
+/* consumer sleeps on eventfd, producer notifies after push (as TaskChannel
+ * does) - no value is lost between failed pop and wait */
+TEST(TaskChannelTests, RingWakeupByEventFd)
+{
+    constexpr int num = 10000;
+
+    SPSCRing<int> ring{4};
+    EventFd event;
+    std::thread producer{[&ring, &event]() {
+        for (int i = 0; i < num; ++i)
+        {
+            while (!ring.push(int{i})) std::this_thread::yield();
+            event.notify();
+        }
+    }};
+
+    int value = 0;
+
+    for (int next = 0; next < num; ++next)
+    {
+        while (!ring.pop(value))
+            ASSERT_TRUE(event.wait(seconds{5}));
+        ASSERT_EQ(value, next);
+    }
+
+    producer.join();
+    /* notifications of values already popped may remain */
+    event.consume();
+    ASSERT_FALSE(event.wait(milliseconds{10}));
+    ASSERT_FALSE(ring.pop(value));
+}
+
+TEST(TaskChannelTests, EventFdCoalescesNotifications)
+{
+    EventFd event;
+
+    ASSERT_FALSE(event.consume());
+    event.notify();
+    event.notify();
+    /* counter is reset - single wakeup for both */
+    ASSERT_TRUE(event.consume());
+    ASSERT_FALSE(event.consume());
+
+    std::thread notifier{[&event]() {
+        std::this_thread::sleep_for(milliseconds{10});
+        event.notify();
+    }};
+
+    event.wait();
+    notifier.join();
+    ASSERT_FALSE(event.consume());
+}
@@ -0,0 +1,544 @@
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mdp/TaskChannel.h"
+#include "mdp/WorkerTask.h"
+
+using namespace std::chrono;
+
+namespace {
+
+/* worker REQUEST (without task identity) */
+MDP::MessageHandle makeRequest(const std::string &body)
+{
+    zmqpp::message request;
+
+    request.raw_new_msg();
+    request.add(MDP::Worker::Signature::self);
+    request.add(MDP::Worker::Signature::request);
+    request.add("client");
+    request.raw_new_msg();
+    request.add(body);
+    return MDP::makeMessageHandle(std::move(request));
+}
+
+/* worker CHUNK (without task identity) */
+MDP::MessageHandle
+makeChunk(size_t no, bool last, const std::string &body = "chunk")
+{
+    zmqpp::message chunk;
+
+    chunk.raw_new_msg();
+    chunk.add(MDP::Worker::Signature::self);
+    chunk.add(MDP::Worker::Signature::chunk);
+    chunk.add("client");
+    chunk.raw_new_msg();
+    chunk.add(std::to_string(no));
+    chunk.add(
+        last ? MDP::Client::Signature::last : MDP::Client::Signature::more);
+    chunk.add(body);
+    return MDP::makeMessageHandle(std::move(chunk));
+}
+
+/* worker side: next message pushed by task */
+MDP::MessageHandle next(TaskChannel &channel)
+{
+    MDP::MessageHandle handle;
+
+    while (!channel.replies_.pop(handle)) channel.replyEvent_.wait();
+    channel.drained();
+    return handle;
+}
+
+bool isReply(const MDP::MessageHandle &handle)
+{
+    return MDP::Worker::Signature::reply == handle->get(2);
+}
+
+bool isFailure(const MDP::MessageHandle &handle)
+{
+    return MDP::Worker::Signature::failure == handle->get(2);
+}
+
+/* task thread runs until exit, args - WorkerTask constructor arguments */
+struct TaskThread
+{
+    TaskChannel &channel_;
+    std::thread thread_;
+
+    template <typename... T>
+    TaskThread(TaskChannel &channel, T... args)
+        : channel_{channel}
+        , thread_{[this, args...]() {
+            WorkerTask task{args...};
+            task(channel_);
+        }}
+    { }
+
+    ~TaskThread()
+    {
+        channel_.exit();
+        thread_.join();
+    }
+};
+
+} /* namespace */
+
+TEST(WorkerTaskTests, StreamWaitsForWorker)
+{
+    const size_t num = 3 * TaskChannel::capacity;
+    std::atomic<size_t> emitted{0};
+    EventFd replyEvent;
+    TaskChannel channel{replyEvent};
+    TaskThread thread{
+        channel, [&emitted](zmqpp::message, const WorkerTask::Emit &emit) {
+            for (size_t i = 0; i < num; ++i)
+            {
+                zmqpp::message part;
+
+                part.add(std::to_string(i));
+                if (!emit(std::move(part))) break;
+                ++emitted;
+            }
+            return zmqpp::message{"last"};
+        }};
+
+    channel.pushRequest(makeRequest("query"));
+    std::this_thread::sleep_for(milliseconds{50});
+    /* task blocks on full ring (no parts dropped) */
+    ASSERT_EQ(emitted, TaskChannel::capacity);
+
+    for (size_t i = 0; i < num; ++i)
+    {
+        auto handle = next(channel);
+
+        ASSERT_EQ(MDP::Worker::Signature::partial, handle->get(2));
+        ASSERT_EQ(std::to_string(i), handle->get(5));
+    }
+
+    auto reply = next(channel);
+
+    ASSERT_TRUE(isReply(reply));
+    ASSERT_EQ("last", reply->get(5));
+    ASSERT_EQ(emitted, num);
+}
+
+TEST(WorkerTaskTests, CancelStopsStream)
+{
+    std::atomic<bool> stopped{false};
+    EventFd replyEvent;
+    TaskChannel channel{replyEvent};
+    TaskThread thread{
+        channel, [&stopped](zmqpp::message, const WorkerTask::Emit &emit) {
+            for (;;)
+            {
+                if (!emit(zmqpp::message{"part"})) break;
+            }
+            stopped = true;
+            return zmqpp::message{};
+        }};
+
+    channel.pushRequest(makeRequest("query"));
+    ASSERT_FALSE(isReply(next(channel)));
+    ASSERT_FALSE(isReply(next(channel)));
+
+    channel.cancel();
+
+    /* parts already in ring are followed by reply (returns credit) */
+    while (!isReply(next(channel)));
+    ASSERT_TRUE(stopped);
+
+    /* next request is streamed again */
+    stopped = false;
+    channel.cancelled_ = false;
+    channel.pushRequest(makeRequest("query"));
+    ASSERT_FALSE(isReply(next(channel)));
+    channel.cancel();
+    while (!isReply(next(channel)));
+    ASSERT_TRUE(stopped);
+}
+
+TEST(WorkerTaskTests, ExitWhileStreamBlocked)
+{
+    std::atomic<size_t> emitted{0};
+    EventFd replyEvent;
+    TaskChannel channel{replyEvent};
+
+    {
+        /* transform ignores cancel - every part after it is dropped */
+        TaskThread thread{
+            channel, [&emitted](zmqpp::message, const WorkerTask::Emit &emit) {
+                for (size_t i = 0; i < 100; ++i)
+                {
+                    if (emit(zmqpp::message{"part"})) ++emitted;
+                }
+                return zmqpp::message{};
+            }};
+
+        channel.pushRequest(makeRequest("query"));
+        std::this_thread::sleep_for(milliseconds{20});
+        /* worker exits without draining replies (thread is joined) */
+    }
+    ASSERT_EQ(emitted, TaskChannel::capacity);
+}
+
+TEST(WorkerTaskTests, ExitWithFullRequests)
+{
+    std::atomic<bool> started{false};
+    std::atomic<bool> release{false};
+    EventFd replyEvent;
+    std::deque<TaskChannel> channels;
+
+    channels.emplace_back(replyEvent);
+
+    auto &channel = channels.front();
+    std::thread thread{[&channel, &started, &release]() {
+        WorkerTask task{WorkerTask::Transform{
+            [&started, &release](zmqpp::message body) {
+                started = true;
+                while (!release) std::this_thread::yield();
+                return body;
+            }}};
+
+        task(channel);
+    }};
+
+    channel.pushRequest(makeRequest("query"));
+    while (!started) std::this_thread::yield();
+
+    /* busy task, requests ring filled behind its request */
+    for (auto handle = makeRequest("query"); channel.tryPushRequest(handle);)
+        handle = makeRequest("query");
+    ASSERT_TRUE(channel.requests_.full());
+
+    /* exit does not wait for free slot */
+    {
+        WorkerTask::MasterGuard guard{channels};
+    }
+    release = true;
+    thread.join();
+    ASSERT_TRUE(channel.exiting_);
+}
+
+TEST(WorkerTaskTests, ViewTransformReadsFramesInPlace)
+{
+    std::vector<const void *> seen;
+    WorkerTask task{
+        WorkerTask::ViewTransform{[&seen](const auto &view, auto &reply) {
+            for (size_t i = 0; i < view.size(); ++i)
+            {
+                seen.push_back(view[i].data());
+                reply.add(std::string{view[i]});
+            }
+        }}};
+    /* multi-frame body */
+    auto request = makeRequest("a");
+
+    request->add("bc");
+
+    const void *first  = request->raw_data(5);
+    const void *second = request->raw_data(6);
+    auto reply = task.process(*request, WorkerTask::Sink{});
+
+    /* view points into request frames - body was not copied */
+    ASSERT_EQ(2, seen.size());
+    ASSERT_EQ(first, seen[0]);
+    ASSERT_EQ(second, seen[1]);
+    ASSERT_EQ(7, reply.parts());
+    ASSERT_EQ("a", reply.get(5));
+    ASSERT_EQ("bc", reply.get(6));
+}
+
+TEST(WorkerTaskTests, ViewTransformEmptyBody)
+{
+    size_t size = 1;
+    WorkerTask task{
+        WorkerTask::ViewTransform{[&size](const auto &view, auto &) {
+            size = view.size();
+        }}};
+    zmqpp::message request;
+
+    /* envelope only, no body frame */
+    request.raw_new_msg();
+    request.add(MDP::Worker::Signature::self);
+    request.add(MDP::Worker::Signature::request);
+    request.add("client");
+    request.raw_new_msg();
+
+    auto reply = task.process(request, WorkerTask::Sink{});
+
+    ASSERT_EQ(0, size);
+    ASSERT_EQ(MDP::Worker::Signature::reply, reply.get(2));
+    ASSERT_EQ("client", reply.get(3));
+    ASSERT_EQ(5, reply.parts());
+}
+
+TEST(WorkerTaskTests, ViewTransformEnvelopeAsTransform)
+{
+    WorkerTask view{
+        WorkerTask::ViewTransform{[](const auto &request, auto &reply) {
+            for (size_t i = 0; i < request.size(); ++i)
+                reply.add(std::string{request[i]});
+        }}};
+    WorkerTask copy{WorkerTask::Transform{[](zmqpp::message body) {
+        return body;
+    }}};
+
+    auto viewRequest = makeRequest("query");
+    auto copyRequest = makeRequest("query");
+    auto viewReply   = view.process(*viewRequest, WorkerTask::Sink{});
+    auto copyReply   = copy.process(*copyRequest, WorkerTask::Sink{});
+
+    ASSERT_EQ(copyReply.parts(), viewReply.parts());
+    for (size_t i = 0; i < copyReply.parts(); ++i)
+        ASSERT_EQ(copyReply.get(i), viewReply.get(i)) << "frame " << i;
+    ASSERT_EQ(0, viewReply.size(0));
+    ASSERT_EQ(MDP::Worker::Signature::self, viewReply.get(1));
+    ASSERT_EQ(0, viewReply.size(4));
+}
+
+namespace {
+
+/* chunked request processed on caller thread */
+struct Upload
+{
+    /* chunks still to arrive (nullptr - client stopped sending) */
+    std::deque<MDP::MessageHandle> chunks_;
+    size_t accepts_{0};
+    bool cancelled_{false};
+
+    WorkerTask::Sink sink()
+    {
+        return [this](zmqpp::message accept) {
+            EXPECT_EQ(MDP::Worker::Signature::accept, accept.get(2));
+            ++accepts_;
+            return !cancelled_;
+        };
+    }
+
+    WorkerTask::Fetch fetch()
+    {
+        return [this]() {
+            MDP::MessageHandle handle;
+
+            if (chunks_.empty()) return handle;
+            handle = std::move(chunks_.front());
+            chunks_.pop_front();
+            return handle;
+        };
+    }
+};
+
+/* reads every chunk, replies their bodies */
+zmqpp::message readAll(WorkerTask::ChunkReader &reader)
+{
+    zmqpp::message reply;
+    zmqpp::message body;
+
+    while (reader.read(body)) reply.add(body.get(0));
+    return reply;
+}
+
+} /* namespace */
+
+TEST(WorkerTaskTests, ChunkReaderReadsInOrder)
+{
+    WorkerTask task{WorkerTask::ChunkedTransform{readAll}};
+    Upload upload;
+
+    upload.chunks_.push_back(makeChunk(1, false, "b"));
+    upload.chunks_.push_back(makeChunk(2, true, "c"));
+
+    auto chunk = makeChunk(0, false, "a");
+    auto reply = task.process(*chunk, upload.sink(), upload.fetch());
+
+    ASSERT_EQ(MDP::Worker::Signature::reply, reply.get(2));
+    ASSERT_EQ("client", reply.get(3));
+    ASSERT_EQ(8, reply.parts());
+    ASSERT_EQ("a", reply.get(5));
+    ASSERT_EQ("b", reply.get(6));
+    ASSERT_EQ("c", reply.get(7));
+    /* last chunk is answered by reply */
+    ASSERT_EQ(2, upload.accepts_);
+}
+
+TEST(WorkerTaskTests, ChunkReaderSingleChunk)
+{
+    bool complete = false;
+    WorkerTask task{
+        WorkerTask::ChunkedTransform{[&complete](auto &reader) {
+            auto reply = readAll(reader);
+
+            complete = reader.complete();
+            return reply;
+        }}};
+    Upload upload;
+
+    auto chunk = makeChunk(0, true, "a");
+    auto reply = task.process(*chunk, upload.sink(), upload.fetch());
+
+    ASSERT_EQ(MDP::Worker::Signature::reply, reply.get(2));
+    ASSERT_EQ("a", reply.get(5));
+    ASSERT_EQ(0, upload.accepts_);
+    ASSERT_TRUE(complete);
+}
+
+TEST(WorkerTaskTests, ChunkReaderPlainRequest)
+{
+    bool complete = false;
+    WorkerTask task{
+        WorkerTask::ChunkedTransform{[&complete](auto &reader) {
+            zmqpp::message reply;
+            zmqpp::message body;
+
+            while (reader.read(body))
+                for (size_t i = 0; i < body.parts(); ++i)
+                    reply.add(body.get(i));
+            complete = reader.complete();
+            return reply;
+        }}};
+    Upload upload;
+
+    /* client did not chunk request, multi-frame body */
+    auto request = makeRequest("a");
+
+    request->add("b");
+
+    auto reply = task.process(*request, upload.sink(), upload.fetch());
+
+    ASSERT_EQ(MDP::Worker::Signature::reply, reply.get(2));
+    ASSERT_EQ("client", reply.get(3));
+    ASSERT_EQ(7, reply.parts());
+    ASSERT_EQ("a", reply.get(5));
+    ASSERT_EQ("b", reply.get(6));
+    ASSERT_EQ(0, upload.accepts_);
+    ASSERT_TRUE(complete);
+}
+
+TEST(WorkerTaskTests, ChunkedTaskServesPlainRequest)
+{
+    EventFd replyEvent;
+    TaskChannel channel{replyEvent};
+    TaskThread thread{channel, WorkerTask::ChunkedTransform{readAll}};
+
+    channel.pushRequest(makeRequest("query"));
+
+    auto reply = next(channel);
+
+    ASSERT_TRUE(isReply(reply));
+    ASSERT_EQ(6, reply->parts());
+    ASSERT_EQ("query", reply->get(5));
+}
+
+TEST(WorkerTaskTests, ChunkReaderAbandoned)
+{
+    bool abandoned = false;
+    WorkerTask task{
+        WorkerTask::ChunkedTransform{[&abandoned](auto &reader) {
+            auto reply = readAll(reader);
+
+            abandoned = reader.abandoned() && !reader.complete();
+            return reply;
+        }}};
+    Upload upload;
+
+    /* chunk 2 never arrives */
+    upload.chunks_.push_back(makeChunk(1, false, "b"));
+
+    auto chunk = makeChunk(0, false, "a");
+    auto reply = task.process(*chunk, upload.sink(), upload.fetch());
+
+    /* partial body is not passed for success */
+    ASSERT_EQ(MDP::Worker::Signature::failure, reply.get(2));
+    ASSERT_EQ("client", reply.get(3));
+    ASSERT_EQ(5, reply.parts());
+    ASSERT_TRUE(abandoned);
+}
+
+TEST(WorkerTaskTests, ChunkReaderCancelled)
+{
+    WorkerTask task{WorkerTask::ChunkedTransform{readAll}};
+    Upload upload;
+
+    upload.cancelled_ = true;
+    upload.chunks_.push_back(makeChunk(1, true, "b"));
+
+    auto chunk = makeChunk(0, false, "a");
+    auto reply = task.process(*chunk, upload.sink(), upload.fetch());
+
+    ASSERT_EQ(MDP::Worker::Signature::failure, reply.get(2));
+    /* accept of chunk 0 was not delivered - nothing more is read */
+    ASSERT_EQ(1, upload.accepts_);
+    ASSERT_EQ(1, upload.chunks_.size());
+}
+
+TEST(WorkerTaskTests, ChunkedTransformRepliesEarly)
+{
+    WorkerTask task{WorkerTask::ChunkedTransform{[](auto &reader) {
+        zmqpp::message body;
+
+        reader.read(body);
+        return zmqpp::message{"rejected"};
+    }}};
+    Upload upload;
+
+    upload.chunks_.push_back(makeChunk(1, true, "b"));
+
+    auto chunk = makeChunk(0, false, "a");
+    auto reply = task.process(*chunk, upload.sink(), upload.fetch());
+
+    /* transform decided - not abandoned */
+    ASSERT_EQ(MDP::Worker::Signature::reply, reply.get(2));
+    ASSERT_EQ("rejected", reply.get(5));
+}
+
+TEST(WorkerTaskTests, ChunkTimeout)
+{
+    EventFd replyEvent;
+    TaskChannel channel{replyEvent};
+    TaskThread thread{
+        channel, WorkerTask::ChunkedTransform{readAll}, milliseconds{20}};
+
+    channel.pushRequest(makeChunk(0, false));
+    ASSERT_EQ(MDP::Worker::Signature::accept, next(channel)->get(2));
+    /* chunk 1 does not arrive */
+    ASSERT_TRUE(isFailure(next(channel)));
+}
+
+TEST(WorkerTaskTests, CancelWakesChunkReader)
+{
+    EventFd replyEvent;
+    TaskChannel channel{replyEvent};
+    TaskThread thread{
+        channel, WorkerTask::ChunkedTransform{readAll}, seconds{10}};
+    const auto start = steady_clock::now();
+
+    channel.pushRequest(makeChunk(0, false));
+    ASSERT_EQ(MDP::Worker::Signature::accept, next(channel)->get(2));
+    channel.cancel();
+    ASSERT_TRUE(isFailure(next(channel)));
+    ASSERT_GT(seconds{1}, steady_clock::now() - start);
+}
+
+TEST(WorkerTaskTests, StaleChunksDiscarded)
+{
+    EventFd replyEvent;
+    TaskChannel channel{replyEvent};
+    TaskThread thread{channel, WorkerTask::ChunkedTransform{readAll}};
+
+    /* chunks of request already replied precede next request */
+    channel.pushRequest(makeChunk(3, false));
+    channel.pushRequest(makeChunk(4, true));
+    channel.pushRequest(makeChunk(0, true, "next"));
+
+    auto reply = next(channel);
+
+    ASSERT_TRUE(isReply(reply));
+    ASSERT_EQ("next", reply->get(5));
+}
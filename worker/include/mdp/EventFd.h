@@ -0,0 +1,27 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/* eventfd(2) wakeup - can be registered in zmqpp::poller (raw fd)
+ *
+ * notify() increments counter (any thread), consume()/wait() reset it */
+class EventFd
+{
+    int fd_;
+public:
+    EventFd();
+    ~EventFd();
+
+    EventFd(const EventFd &)            = delete;
+    EventFd &operator=(const EventFd &) = delete;
+
+    int fd() const { return fd_; }
+    void notify();
+    /* non-blocking, false if not notified since last consume/wait */
+    bool consume();
+    /* blocks until notified */
+    void wait();
+    /* false if not notified within timeout */
+    bool wait(std::chrono::milliseconds timeout);
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+
+#include "ensure/Ensure.h"
+#include "mdp/EventFd.h"
+#include "mdp/Except.h"
+#include "mdp/MDP.h"
+#include "mdp/SPSCRing.h"
+
+/* Worker <-> WorkerTask hop (single task thread)
+ *
+ * Requests and replies are passed as message handles through lock-free
+ * rings, no copy and no allocation per request. Null handle is a control
+ * message: exited (from task). Exit (to task) is a flag, it must not wait
+ * for free slot of requests ring.
+ *
+ * Streamed reply (or ACCEPTs of chunked request) can have any number of
+ * parts - task blocks on replySpaceEvent_ while replies ring is full. */
+struct TaskChannel
+{
+    using MessageHandle = MDP::MessageHandle;
+    using Ring          = SPSCRing<MessageHandle>;
+
+    /* Worker pushes request only to idle task - request (or reply) and
+     * control message at most, chunks of chunked request are bounded by
+     * client window */
+    static constexpr size_t capacity = 8;
+
+    static_assert(
+        MDP::Client::chunkWindow + 1 <= capacity,
+        "chunk window and control message expected to fit");
+
+    /* Worker -> WorkerTask */
+    Ring requests_{capacity};
+    EventFd requestEvent_;
+    /* WorkerTask -> Worker, wakeup shared by channels of all tasks */
+    Ring replies_{capacity};
+    EventFd &replyEvent_;
+    /* Worker -> WorkerTask, replies ring was drained */
+    EventFd replySpaceEvent_;
+    /* WorkerTask waits for replySpaceEvent_ */
+    std::atomic<bool> replyWaiting_{false};
+    /* current request was cancelled (or worker exits) - parts still to be
+     * streamed are dropped, chunked request is abandoned */
+    std::atomic<bool> cancelled_{false};
+    /* worker exits - task abandons current request and returns */
+    std::atomic<bool> exiting_{false};
+
+    explicit TaskChannel(EventFd &replyEvent)
+        : replyEvent_{replyEvent}
+    { }
+
+    TaskChannel(const TaskChannel &)            = delete;
+    TaskChannel &operator=(const TaskChannel &) = delete;
+
+    /* Worker thread only */
+    void pushRequest(MessageHandle handle)
+    {
+        ENSURE(requests_.push(std::move(handle)), FlowError);
+        requestEvent_.notify();
+    }
+
+    /* Worker thread only, false if ring is full (handle is left intact) */
+    bool tryPushRequest(MessageHandle &handle)
+    {
+        if (!requests_.push(std::move(handle))) return false;
+        requestEvent_.notify();
+        return true;
+    }
+
+    /* Worker thread only, stops streaming (or chunk reading) of current
+     * request */
+    void cancel()
+    {
+        cancelled_ = true;
+        replySpaceEvent_.notify();
+        requestEvent_.notify();
+    }
+
+    /* Worker thread only, never blocks (requests ring may be full of
+     * chunks) */
+    void exit()
+    {
+        exiting_ = true;
+        cancel();
+    }
+
+    /* Worker thread only, after replies were popped */
+    void drained()
+    {
+        /* pairs with fence in waitReplySpace - either task sees free slot
+         * or worker sees it waiting */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (replyWaiting_.exchange(false)) replySpaceEvent_.notify();
+    }
+
+    /* WorkerTask thread only, nullptr - exited */
+    void pushReply(MessageHandle handle)
+    {
+        ENSURE(replies_.push(std::move(handle)), FlowError);
+        replyEvent_.notify();
+    }
+
+    /* WorkerTask thread only, false if ring is full (handle is left
+     * intact) */
+    bool tryPushReply(MessageHandle &handle)
+    {
+        if (!replies_.push(std::move(handle))) return false;
+        replyEvent_.notify();
+        return true;
+    }
+
+    /* WorkerTask thread only, blocks until worker drains replies (or
+     * cancels) */
+    void waitReplySpace()
+    {
+        replyWaiting_ = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        /* slot freed before worker saw task waiting */
+        if (!replies_.full()) return;
+        replySpaceEvent_.wait();
+    }
+};
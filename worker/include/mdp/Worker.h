@@ -1,9 +1,18 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "mdp/MDP.h"
 #include "mdp/MutualHeartbeatMonitor.h"
 #include "mdp/WorkerTask.h"
 #include "mdp/ZMQWorkerContext.h"
+#include "mdp/utils.h"
 
 class Worker
 {
@@ -12,19 +21,112 @@ class Worker
     using ZMQContext    = ZMQWorkerContext;
 
 public:
+    /* heartbeat period and liveness proposed to broker in READY (0 - broker
+     * decides), effective values are set by broker */
+    explicit Worker(
+        std::chrono::milliseconds heartbeat = std::chrono::milliseconds{0},
+        size_t liveness                     = 0);
+
+    /* concurrency - number of WorkerTask threads (requests processed
+     * concurrently), with concurrency > 1 transform must be thread safe
+     * credits - max number of requests broker keeps in flight to worker
+     * (0 - same as concurrency), credits above concurrency are prefetched
+     * requests waiting for idle WorkerTask */
+    void exec(
+        const std::string &address,
+        const std::string &serviceName,
+        WorkerTask::Transform,
+        size_t concurrency = 1,
+        size_t credits     = 0);
+    /* transform reads request body in place and appends reply body to
+     * reply prepared by WorkerTask (no per request message shuffling) */
+    void exec(
+        const std::string &address,
+        const std::string &serviceName,
+        WorkerTask::ViewTransform,
+        size_t concurrency = 1,
+        size_t credits     = 0);
+    /* streamed reply - parts emitted by transform are forwarded to client
+     * as they are produced (no credit is returned until last part) */
     void exec(
         const std::string &address,
         const std::string &serviceName,
-        WorkerTask::Transform);
+        WorkerTask::StreamTransform,
+        size_t concurrency = 1,
+        size_t credits     = 0);
+    /* chunked request - transform reads chunks as they arrive (request
+     * body is never assembled), each chunk read lets client send next one
+     * (separate name - zmqpp::message converts from almost anything),
+     * request is abandoned if next chunk does not arrive within
+     * chunkTimeout */
+    void execChunked(
+        const std::string &address,
+        const std::string &serviceName,
+        WorkerTask::ChunkedTransform,
+        size_t concurrency = 1,
+        size_t credits     = 0,
+        std::chrono::milliseconds chunkTimeout
+        = WorkerTask::defaultChunkTimeout);
+    /* inline - transform runs on worker thread between broker messages (no
+     * WorkerTask thread, no hop to it), for short non-blocking transforms
+     * only (heartbeats are handled between requests) */
+    void execInline(
+        const std::string &address,
+        const std::string &serviceName,
+        WorkerTask::Transform,
+        size_t credits = 1);
+    void execInline(
+        const std::string &address,
+        const std::string &serviceName,
+        WorkerTask::ViewTransform,
+        size_t credits = 1);
+    void execInline(
+        const std::string &address,
+        const std::string &serviceName,
+        WorkerTask::StreamTransform,
+        size_t credits = 1);
+    /* exec disconnects and returns within heartbeat period (may be called
+     * from any thread) */
+    void stop();
 private:
+    /* runs WorkerTask on its channel */
+    using TaskRunner = std::function<void(TaskChannel &)>;
+
+    std::atomic<bool> stopped_{false};
+    std::chrono::milliseconds heartbeat_;
+    size_t liveness_;
     MutualHeartbeatMonitor monitor_;
+    /* channels (numbers) of WorkerTasks waiting for request */
+    std::deque<size_t> idleTasks_;
+    /* client address key of request processed by WorkerTask (by channel,
+     * empty if task is idle) - CANCEL stops its streaming */
+    std::vector<std::string> taskKeys_;
+    /* requests received while all WorkerTasks are busy (prefetched) */
+    std::deque<MessageHandle> pendingRequests_;
+    /* inline mode - requests are processed by this task directly */
+    WorkerTask *inlineTask_{nullptr};
+    /* worker accepts chunked requests (advertised in READY) */
+    bool chunked_{false};
+    /* chunked request with chunks to come */
+    struct ChunkedTask
+    {
+        /* channel of task reading chunks */
+        size_t task_;
+        /* number of next chunk (others are out of order) */
+        size_t next_;
+    };
+
+    /* client address key -> ChunkedTask */
+    std::unordered_map<std::string, ChunkedTask> chunkedTasks_;
 
     enum class Tag
     {
         ClientRequest,
+        ClientChunk,
         ClientResponse,
         BrokerHeartbeat,
         BrokerDisconnect,
+        BrokerCancel,
         Unsupported
     };
 
@@ -44,17 +146,35 @@ private:
         { }
     };
 
-    void exec(ZMQContext &, const std::string &);
-    void registerService(ZMQContext &, const std::string &);
+    void serve(
+        const std::string &address,
+        const std::string &serviceName,
+        const TaskRunner &,
+        size_t concurrency,
+        size_t credits,
+        bool chunked = false);
+    void serveInline(
+        const std::string &address,
+        const std::string &serviceName,
+        WorkerTask &,
+        size_t credits);
+    void exec(ZMQContext &, const std::string &, size_t, size_t);
+    void registerService(ZMQContext &, const std::string &, size_t, size_t);
     void provideService(ZMQContext &, const std::string &);
     void onMessage(ZMQContext &, MessageHandle);
-    void onTaskMessage(ZMQContext &, MessageHandle);
+    /* false if WorkerTask exited */
+    bool onTaskReplies(ZMQContext &);
     void onTimeout(ZMQContext &);
+    void dispatchPending(ZMQContext &);
     void sendHeartbeatIfNeeded(ZMQContext &);
+    void sendToBroker(ZMQContext &, Message, IOMode = IOMode::Blocking);
     /* Client */
     void dispatch(ZMQContext &, Tagged<Tag::ClientRequest>);
+    /* chunk 0 is dispatched as request */
+    void dispatch(ZMQContext &, Tagged<Tag::ClientChunk>);
     void dispatch(ZMQContext &, Tagged<Tag::ClientResponse>);
     void dispatch(ZMQContext &, Tagged<Tag::BrokerHeartbeat>);
     void dispatch(ZMQContext &, Tagged<Tag::BrokerDisconnect>);
+    void dispatch(ZMQContext &, Tagged<Tag::BrokerCancel>);
     void dispatch(ZMQContext &, Tagged<Tag::Unsupported>);
 };
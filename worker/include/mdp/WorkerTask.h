@@ -1,44 +1,166 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <deque>
 #include <functional>
+#include <string_view>
 
 #include <zmqpp/zmqpp.hpp>
 
+#include "mdp/TaskChannel.h"
+
 struct WorkerTask
 {
-    struct Guard
+    /* exit is sent to every task */
+    struct MasterGuard
     {
-        zmqpp::socket &socket_;
-        explicit Guard(zmqpp::socket &socket)
-            : socket_{socket}
+        std::deque<TaskChannel> &channels_;
+
+        explicit MasterGuard(std::deque<TaskChannel> &channels)
+            : channels_{channels}
         { }
+        ~MasterGuard();
 
-        Guard(const Guard &)            = delete;
-        Guard &operator=(const Guard &) = delete;
+        MasterGuard(const MasterGuard &)            = delete;
+        MasterGuard &operator=(const MasterGuard &) = delete;
     };
 
-    struct MasterGuard : public Guard
+    /* exited is sent to worker */
+    struct SlaveGuard
     {
-        using Guard::Guard;
-        ~MasterGuard();
+        TaskChannel &channel_;
+
+        explicit SlaveGuard(TaskChannel &channel)
+            : channel_{channel}
+        { }
+        ~SlaveGuard();
+
+        SlaveGuard(const SlaveGuard &)            = delete;
+        SlaveGuard &operator=(const SlaveGuard &) = delete;
     };
 
-    struct SlaveGuard : public Guard
+    /* read-only view of request body frames (valid during transform call) */
+    struct FrameView
     {
-        using Guard::Guard;
-        ~SlaveGuard();
+    private:
+        const zmqpp::message &message_;
+        /* first body frame */
+        size_t first_;
+    public:
+        FrameView(const zmqpp::message &message, size_t first)
+            : message_{message}
+            , first_{first}
+        { }
+
+        size_t size() const { return message_.parts() - first_; }
+
+        std::string_view operator[](size_t i) const
+        {
+            return std::string_view{
+                static_cast<const char *>(message_.raw_data(first_ + i)),
+                message_.size(first_ + i)};
+        }
     };
 
+    /* request body -> reply body */
     using Transform = std::function<zmqpp::message(zmqpp::message)>;
+    /* reply body frames are appended to reply (envelope already in place) */
+    using ViewTransform
+        = std::function<void(const FrameView &, zmqpp::message &reply)>;
+
+    /* sends reply body part to client right away (reply is streamed),
+     * false if request was cancelled (client is gone) - part is dropped and
+     * transform should return */
+    using Emit = std::function<bool(zmqpp::message)>;
+    /* request body -> last reply body part, any number of parts may be
+     * emitted before (Emit is valid during transform call only) */
+    using StreamTransform
+        = std::function<zmqpp::message(zmqpp::message, const Emit &)>;
+    /* receives complete worker PARTIAL (or ACCEPT), false if request was
+     * cancelled */
+    using Sink = std::function<bool(zmqpp::message)>;
+    /* next worker CHUNK of chunked request, nullptr if it did not arrive
+     * (within chunkTimeout_) or request was cancelled */
+    using Fetch = std::function<MDP::MessageHandle()>;
 
+    /* client stopped sending chunks - chunked request is abandoned */
+    static constexpr std::chrono::milliseconds defaultChunkTimeout{10000};
+
+    /* chunks of chunked request in order (valid during transform call),
+     * each chunk read is accepted - client may send next one */
+    class ChunkReader
+    {
+        const Sink &sink_;
+        const Fetch &fetch_;
+        std::string clientAddress_;
+        /* body of chunk not read yet */
+        zmqpp::message next_;
+        bool pending_{true};
+        /* next_ is last chunk */
+        bool last_;
+        /* next chunk did not arrive (or request was cancelled) */
+        bool abandoned_{false};
+    public:
+        /* chunk - worker CHUNK of chunk 0 or plain REQUEST (read as single
+         * chunk; client address frame may be already moved out) */
+        ChunkReader(
+            std::string clientAddress,
+            zmqpp::message &chunk,
+            const Sink &,
+            const Fetch &);
+
+        /* body of next chunk, false after last chunk or if request was
+         * abandoned (or cancelled) */
+        bool read(zmqpp::message &body);
+        /* last chunk was read */
+        bool complete() const { return last_ && !pending_; }
+        /* reply is replaced by FAILURE */
+        bool abandoned() const { return abandoned_; }
+    };
+
+    /* chunked request -> reply body */
+    using ChunkedTransform = std::function<zmqpp::message(ChunkReader &)>;
+
+    /* exactly one is set */
     Transform transform_;
+    ViewTransform viewTransform_;
+    StreamTransform streamTransform_;
+    ChunkedTransform chunkedTransform_;
+    /* max wait for next chunk of chunked request */
+    std::chrono::milliseconds chunkTimeout_{defaultChunkTimeout};
 
     explicit WorkerTask(Transform transform)
         : transform_{std::move(transform)}
     { }
 
+    explicit WorkerTask(ViewTransform viewTransform)
+        : viewTransform_{std::move(viewTransform)}
+    { }
+
+    explicit WorkerTask(StreamTransform streamTransform)
+        : streamTransform_{std::move(streamTransform)}
+    { }
+
+    explicit WorkerTask(
+        ChunkedTransform chunkedTransform,
+        std::chrono::milliseconds chunkTimeout = defaultChunkTimeout)
+        : chunkedTransform_{std::move(chunkedTransform)}
+        , chunkTimeout_{chunkTimeout}
+    {
+        ENSURE(0 < chunkTimeout_.count(), RuntimeError);
+    }
+
     WorkerTask(const WorkerTask &)            = delete;
     WorkerTask &operator=(const WorkerTask &) = delete;
 
-    void operator()(zmqpp::socket &);
+    /* processes requests of channel until exit */
+    void operator()(TaskChannel &);
+    /* worker REQUEST (without task identity) -> worker REPLY, frames of
+     * request are moved into reply, PARTIALs emitted by StreamTransform
+     * are passed to sink before
+     * worker CHUNK (chunk 0) - next chunks are fetched, ACCEPTs are passed
+     * to sink, abandoned request -> worker FAILURE */
+    zmqpp::message process(
+        zmqpp::message &request, const Sink &sink, const Fetch &fetch = {});
 };
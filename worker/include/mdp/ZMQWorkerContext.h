@@ -1,22 +1,29 @@
 #pragma once
 
 #include <chrono>
+#include <deque>
 #include <memory>
+#include <string>
 
 #include <zmqpp/zmqpp.hpp>
 
+#include "mdp/EventFd.h"
 #include "mdp/MDP.h"
+#include "mdp/TaskChannel.h"
 #include "mdp/ZMQIdentity.h"
 
+/* taskChannels_ - one per WorkerTask thread (none if concurrency is 0 -
+ * inline worker), replyEvent_ is signalled by any of them */
 struct ZMQWorkerContext
 {
     zmqpp::context context_;
     zmqpp::socket socket_;
-    zmqpp::socket masterSocket_;
-    zmqpp::socket slaveSocket_;
+    EventFd replyEvent_;
+    std::deque<TaskChannel> taskChannels_;
     zmqpp::poller poller_;
     ZMQIdentity identity_;
     std::string address_;
 
-    ZMQWorkerContext(ZMQIdentity identity, std::string address);
+    ZMQWorkerContext(
+        ZMQIdentity identity, std::string address, size_t concurrency = 1);
 };
@@ -0,0 +1,71 @@
+#include "mdp/EventFd.h"
+#include "ensure/Ensure.h"
+#include "mdp/Except.h"
+
+#include <cerrno>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+EventFd::EventFd()
+    : fd_{::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)}
+{
+    ENSURE(0 <= fd_, RuntimeError);
+}
+
+EventFd::~EventFd()
+{
+    ::close(fd_);
+}
+
+void EventFd::notify()
+{
+    const uint64_t value = 1;
+
+    /* EAGAIN only if counter would overflow - wakeup is pending anyway */
+    const auto status = ::write(fd_, &value, sizeof(value));
+
+    ENSURE(ssize_t(sizeof(value)) == status || EAGAIN == errno, SendFailed);
+}
+
+bool EventFd::consume()
+{
+    uint64_t value    = 0;
+    const auto status = ::read(fd_, &value, sizeof(value));
+
+    if (ssize_t(sizeof(value)) == status) return true;
+
+    ENSURE(EAGAIN == errno || EINTR == errno, RecvFailed);
+    return false;
+}
+
+void EventFd::wait()
+{
+    while (!consume())
+    {
+        pollfd pfd{fd_, POLLIN, 0};
+
+        ENSURE(0 <= ::poll(&pfd, 1, -1) || EINTR == errno, RecvFailed);
+    }
+}
+
+bool EventFd::wait(std::chrono::milliseconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (!consume())
+    {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+
+        if (0 >= left.count()) return false;
+
+        pollfd pfd{fd_, POLLIN, 0};
+
+        ENSURE(
+            0 <= ::poll(&pfd, 1, int(left.count())) || EINTR == errno,
+            RecvFailed);
+    }
+    return true;
+}
@@ -1,8 +1,11 @@
 #include "mdp/Worker.h"
 #include "mdp/Except.h"
+#include "mdp/FastTrace.h"
 #include "mdp/utils.h"
 
+#include <algorithm>
 #include <future>
+#include <vector>
 
 namespace {
 
@@ -23,47 +26,235 @@ struct Guard
 
 } /* namespace */
 
+Worker::Worker(std::chrono::milliseconds heartbeat, size_t liveness)
+    : heartbeat_{heartbeat}
+    , liveness_{liveness}
+{
+    ENSURE(0 <= heartbeat_.count(), RuntimeError);
+}
+
+void Worker::exec(
+    const std::string &address,
+    const std::string &serviceName,
+    WorkerTask::Transform transform,
+    size_t concurrency,
+    size_t credits)
+{
+    serve(
+        address, serviceName,
+        [&transform](TaskChannel &channel) {
+            WorkerTask task{transform};
+            task(channel);
+        },
+        concurrency, credits);
+}
+
 void Worker::exec(
     const std::string &address,
     const std::string &serviceName,
-    WorkerTask::Transform transform)
+    WorkerTask::ViewTransform viewTransform,
+    size_t concurrency,
+    size_t credits)
+{
+    serve(
+        address, serviceName,
+        [&viewTransform](TaskChannel &channel) {
+            WorkerTask task{viewTransform};
+            task(channel);
+        },
+        concurrency, credits);
+}
+
+void Worker::exec(
+    const std::string &address,
+    const std::string &serviceName,
+    WorkerTask::StreamTransform streamTransform,
+    size_t concurrency,
+    size_t credits)
+{
+    serve(
+        address, serviceName,
+        [&streamTransform](TaskChannel &channel) {
+            WorkerTask task{streamTransform};
+            task(channel);
+        },
+        concurrency, credits);
+}
+
+void Worker::execChunked(
+    const std::string &address,
+    const std::string &serviceName,
+    WorkerTask::ChunkedTransform chunkedTransform,
+    size_t concurrency,
+    size_t credits,
+    std::chrono::milliseconds chunkTimeout)
+{
+    serve(
+        address, serviceName,
+        [&chunkedTransform, chunkTimeout](TaskChannel &channel) {
+            WorkerTask task{chunkedTransform, chunkTimeout};
+            task(channel);
+        },
+        concurrency, credits, true);
+}
+
+void Worker::execInline(
+    const std::string &address,
+    const std::string &serviceName,
+    WorkerTask::Transform transform,
+    size_t credits)
+{
+    WorkerTask task{std::move(transform)};
+
+    serveInline(address, serviceName, task, credits);
+}
+
+void Worker::execInline(
+    const std::string &address,
+    const std::string &serviceName,
+    WorkerTask::ViewTransform viewTransform,
+    size_t credits)
+{
+    WorkerTask task{std::move(viewTransform)};
+
+    serveInline(address, serviceName, task, credits);
+}
+
+void Worker::execInline(
+    const std::string &address,
+    const std::string &serviceName,
+    WorkerTask::StreamTransform streamTransform,
+    size_t credits)
+{
+    WorkerTask task{std::move(streamTransform)};
+
+    serveInline(address, serviceName, task, credits);
+}
+
+void Worker::serve(
+    const std::string &address,
+    const std::string &serviceName,
+    const TaskRunner &runTask,
+    size_t concurrency,
+    size_t credits,
+    bool chunked)
 {
-    for (;;)
+    if (0 == credits) credits = concurrency;
+
+    ENSURE(0 < concurrency, RuntimeError);
+    ENSURE(concurrency <= credits, RuntimeError);
+
+    inlineTask_ = nullptr;
+    chunked_    = chunked;
+
+    while (!stopped_)
     {
-        monitor_.reset();
+        /* MDP default until broker sets effective heartbeat */
+        monitor_ = MutualHeartbeatMonitor{};
+        idleTasks_.clear();
+        taskKeys_.assign(concurrency, std::string{});
+        pendingRequests_.clear();
+        chunkedTasks_.clear();
 
         TRACE(
             TraceLevel::Info, this, " service ", serviceName, " broker ",
-            address);
+            address, " concurrency ", concurrency, " credits ", credits);
 
-        auto zmqContext = ZMQContext{ZMQIdentity::unique(), address};
+        auto zmqContext
+            = ZMQContext{ZMQIdentity::unique(), address, concurrency};
 
         /* in case of worker crash - send disconnect to broker */
         Guard guard{zmqContext.socket_};
 
-        auto r = std::async(std::launch::async, [&transform, &zmqContext]() {
-            WorkerTask task{transform};
-            task(zmqContext.slaveSocket_);
-        });
+        std::vector<std::future<void>> tasks;
+
+        for (auto &channel : zmqContext.taskChannels_)
+        {
+            /* task is idle until first request is pushed to its channel */
+            idleTasks_.push_back(tasks.size());
+            tasks.push_back(std::async(
+                std::launch::async,
+                [&runTask, &channel]() { runTask(channel); }));
+        }
 
-        WorkerTask::MasterGuard masterGuard{zmqContext.masterSocket_};
+        {
+            WorkerTask::MasterGuard masterGuard{zmqContext.taskChannels_};
 
-        exec(zmqContext, serviceName);
+            exec(zmqContext, serviceName, concurrency, credits);
+        }
         /* if worker thread throws exception it will be propagated on get() */
-        r.get();
+        for (auto &r : tasks) r.get();
     }
 }
 
-void Worker::exec(ZMQContext &zmqContext, const std::string &serviceName)
+void Worker::serveInline(
+    const std::string &address,
+    const std::string &serviceName,
+    WorkerTask &task,
+    size_t credits)
 {
-    registerService(zmqContext, serviceName);
+    ENSURE(0 < credits, RuntimeError);
+
+    /* MDP default until broker sets effective heartbeat */
+    monitor_ = MutualHeartbeatMonitor{};
+    idleTasks_.clear();
+    taskKeys_.clear();
+    pendingRequests_.clear();
+    inlineTask_ = &task;
+    chunked_    = false;
+
+    TRACE(
+        TraceLevel::Info, this, " service ", serviceName, " broker ", address,
+        " inline credits ", credits);
+
+    /* no WorkerTask threads */
+    auto zmqContext = ZMQContext{ZMQIdentity::unique(), address, 0};
+
+    /* in case of worker crash - send disconnect to broker */
+    Guard guard{zmqContext.socket_};
+
+    /* returns on stop or by exception (no WorkerTask to exit) */
+    exec(zmqContext, serviceName, 1, credits);
+}
+
+void Worker::exec(
+    ZMQContext &zmqContext,
+    const std::string &serviceName,
+    size_t concurrency,
+    size_t credits)
+{
+    registerService(zmqContext, serviceName, concurrency, credits);
     provideService(zmqContext, serviceName);
 }
 
 void Worker::registerService(
-    ZMQContext &zmqContext, const std::string &serviceName)
+    ZMQContext &zmqContext,
+    const std::string &serviceName,
+    size_t concurrency,
+    size_t credits)
 {
-    auto ready = MDP::Worker::makeReady(serviceName);
+    using namespace MDP::Worker;
+
+    std::vector<std::string> properties;
+
+    /* single credit is MDP default (property omitted) */
+    if (1 < credits)
+        properties.push_back(
+            makeProperty(Property::credits, std::to_string(credits)));
+    /* prefetched requests (waiting for idle WorkerTask) are skipped,
+     * streaming is stopped - inline worker can do neither */
+    if (nullptr == inlineTask_)
+        properties.push_back(makeProperty(Property::cancel, "1"));
+    if (chunked_) properties.push_back(makeProperty(Property::chunked, "1"));
+    /* announced always - broker (service) heartbeat applies to workers
+     * which understand HEARTBEAT properties only */
+    properties.push_back(makeProperty(
+        Property::heartbeat, std::to_string(heartbeat_.count())));
+    if (0 < liveness_)
+        properties.push_back(
+            makeProperty(Property::liveness, std::to_string(liveness_)));
+
+    auto ready = makeReady(serviceName, properties);
 
     TRACE(TraceLevel::Info, this, ' ', serviceName, ' ', ready);
 
@@ -71,13 +262,17 @@ void Worker::registerService(
     monitor_.selfHeartbeat();
 }
 
+void Worker::stop()
+{
+    stopped_ = true;
+}
+
 void Worker::provideService(
     ZMQContext &zmqContext, const std::string &serviceName)
 {
-    for (uint64_t cntr = 0;; ++cntr)
+    for (uint64_t cntr = 0; !stopped_; ++cntr)
     {
-        TRACE(
-            TraceLevel::Trace, this, ' ', serviceName, " [", cntr, "] waiting");
+        FAST_TRACE(Trace, "waiting", serviceName, cntr);
 
         if (zmqContext.poller_.poll(monitor_.period().count()))
         {
@@ -87,15 +282,11 @@ void Worker::provideService(
 
                 if (handle) onMessage(zmqContext, std::move(handle));
             }
-            else if (zmqContext.poller_.has_input(zmqContext.masterSocket_))
+            else if (
+                nullptr == inlineTask_
+                && zmqContext.poller_.has_input(zmqContext.replyEvent_.fd()))
             {
-                auto handle
-                    = recv(zmqContext.masterSocket_, IOMode::NonBlockig);
-
-                if (handle && 1 == handle->parts()
-                    && "exited" == handle->get(0))
-                    break;
-                if (handle) onTaskMessage(zmqContext, std::move(handle));
+                if (!onTaskReplies(zmqContext)) break;
             }
             else { ENSURE(false && " not supported", FlowError); }
 
@@ -130,10 +321,17 @@ void Worker::onMessage(ZMQContext &zmqContext, MessageHandle handle)
         return;
     }
 
+    /* every valid message received is treated as peers heartbeat */
+    monitor_.peerHeartbeat();
+
     if (MDP::Worker::Signature::request == handle->get(2))
     {
         dispatch(zmqContext, Tagged<Tag::ClientRequest>{std::move(handle)});
     }
+    else if (MDP::Worker::Signature::chunk == handle->get(2))
+    {
+        dispatch(zmqContext, Tagged<Tag::ClientChunk>{std::move(handle)});
+    }
     else if (MDP::Worker::Signature::heartbeat == handle->get(2))
     {
         dispatch(zmqContext, Tagged<Tag::BrokerHeartbeat>{std::move(handle)});
@@ -142,14 +340,82 @@ void Worker::onMessage(ZMQContext &zmqContext, MessageHandle handle)
     {
         dispatch(zmqContext, Tagged<Tag::BrokerDisconnect>{std::move(handle)});
     }
+    else if (MDP::Worker::Signature::cancel == handle->get(2))
+    {
+        dispatch(zmqContext, Tagged<Tag::BrokerCancel>{std::move(handle)});
+    }
     else { dispatch(zmqContext, Tagged<Tag::Unsupported>{std::move(handle)}); }
 }
 
-void Worker::onTaskMessage(ZMQContext &zmqContext, MessageHandle handle)
+bool Worker::onTaskReplies(ZMQContext &zmqContext)
 {
-    ASSERT(handle);
-    TRACE(TraceLevel::Trace, this, ' ', handle);
-    dispatch(zmqContext, Tagged<Tag::ClientResponse>{std::move(handle)});
+    /* reset before rings are read - reply pushed later wakes poller again */
+    zmqContext.replyEvent_.consume();
+
+    auto &channels = zmqContext.taskChannels_;
+
+    for (size_t no = 0; no < channels.size(); ++no)
+    {
+        MessageHandle handle;
+
+        while (channels[no].replies_.pop(handle))
+        {
+            /* WorkerTask exited */
+            if (!handle) return false;
+
+            FAST_TRACE(Trace, "task reply", no);
+            /* task is idle after (last) reply or failure, not after
+             * PARTIAL or ACCEPT */
+            if (MDP::Worker::Signature::reply == handle->get(2)
+                || MDP::Worker::Signature::failure == handle->get(2))
+            {
+                idleTasks_.push_back(no);
+                taskKeys_[no].clear();
+                /* chunks still to come are discarded */
+                if (!chunkedTasks_.empty()) chunkedTasks_.erase(handle->get(3));
+            }
+            dispatch(
+                zmqContext, Tagged<Tag::ClientResponse>{std::move(handle)});
+        }
+        /* wakes task blocked on full ring */
+        channels[no].drained();
+    }
+    dispatchPending(zmqContext);
+    return true;
+}
+
+void Worker::dispatchPending(ZMQContext &zmqContext)
+{
+    while (!idleTasks_.empty() && !pendingRequests_.empty())
+    {
+        auto &handle = pendingRequests_.front();
+        /* idle task may still hold stale chunks of replied request (or
+         * chunks above window) - request waits for task with free slot,
+         * retried on next reply, request or timeout */
+        const auto i = std::find_if(
+            std::begin(idleTasks_), std::end(idleTasks_),
+            [&zmqContext](size_t no) {
+                return !zmqContext.taskChannels_[no].requests_.full();
+            });
+
+        if (std::end(idleTasks_) == i) return;
+
+        const auto no   = *i;
+        auto &channel   = zmqContext.taskChannels_[no];
+        auto key        = handle->get(3);
+        const auto more = MDP::Worker::Signature::chunk == handle->get(2)
+                          && MDP::Client::Signature::more == handle->get(6);
+
+        /* cancel of previous request (if any) no longer applies */
+        channel.cancelled_ = false;
+        if (!channel.tryPushRequest(handle)) return;
+
+        pendingRequests_.pop_front();
+        idleTasks_.erase(i);
+        /* next chunks go straight to task which took chunk 0 */
+        if (more) chunkedTasks_[key] = ChunkedTask{no, 1};
+        taskKeys_[no] = std::move(key);
+    }
 }
 
 void Worker::onTimeout(ZMQContext &zmqContext)
@@ -157,37 +423,138 @@ void Worker::onTimeout(ZMQContext &zmqContext)
     /* check broker heartbeating, if expired abort and restart */
     ENSURE(!monitor_.peerHeartbeatExpired(), BrokerHeartbeatExpired);
     sendHeartbeatIfNeeded(zmqContext);
+    /* task rings may have been drained meanwhile */
+    dispatchPending(zmqContext);
 }
 
 void Worker::sendHeartbeatIfNeeded(ZMQContext &zmqContext)
 {
+    /* only if nothing was sent to broker for whole period */
     if (!monitor_.shouldHeartbeat()) return;
-    send(zmqContext.socket_, MDP::Worker::makeHeartbeat(), IOMode::NonBlockig);
+    FAST_TRACE(Trace, "heartbeat");
+    sendToBroker(
+        zmqContext, MDP::Worker::makeHeartbeat(), IOMode::NonBlockig);
+}
+
+void Worker::sendToBroker(
+    ZMQContext &zmqContext, Message message, IOMode ioMode)
+{
+    send(zmqContext.socket_, std::move(message), ioMode);
+    /* every message sent is treated as heartbeat by broker */
     monitor_.selfHeartbeat();
 }
 
 void Worker::dispatch(ZMQContext &zmqContext, Tagged<Tag::ClientRequest> tagged)
 {
     ASSERT(tagged.handle);
-    TRACE(TraceLevel::Debug, this, ' ', tagged.handle);
-    /* every valid message received is treated as peers heartbeat */
-    monitor_.peerHeartbeat();
-    send(zmqContext.masterSocket_, std::move(*tagged.handle), IOMode::Blocking);
+    FAST_TRACE(Debug, "client req", tagged.handle);
+
+    if (nullptr != inlineTask_)
+    {
+        /* next message (or heartbeat) is handled once transform returns */
+        auto reply = inlineTask_->process(
+            *tagged.handle, [this, &zmqContext](zmqpp::message partial) {
+                sendToBroker(zmqContext, std::move(partial));
+                return true;
+            });
+
+        sendToBroker(zmqContext, std::move(reply));
+        return;
+    }
+
+    /* broker keeps at most credits requests in flight, requests above
+     * concurrency wait for idle WorkerTask */
+    pendingRequests_.push_back(std::move(tagged.handle));
+    dispatchPending(zmqContext);
+}
+
+void Worker::dispatch(ZMQContext &zmqContext, Tagged<Tag::ClientChunk> tagged)
+{
+    ASSERT(tagged.handle);
+    FAST_TRACE(Debug, "client chunk", tagged.handle);
+
+    /* Frames: empty, "MDPW01", 0x08, client address, empty, chunk number,
+     * flag */
+    if (7 > tagged.handle->parts() || nullptr != inlineTask_)
+    {
+        dispatch(
+            zmqContext, Tagged<Tag::Unsupported>{std::move(tagged.handle)});
+        return;
+    }
+
+    if ("0" == tagged.handle->get(5))
+    {
+        dispatch(
+            zmqContext, Tagged<Tag::ClientRequest>{std::move(tagged.handle)});
+        return;
+    }
+
+    const auto i = chunkedTasks_.find(tagged.handle->get(3));
+
+    /* task already replied (or abandoned request) */
+    if (std::end(chunkedTasks_) == i)
+    {
+        FAST_TRACE(Debug, "client chunk discarded", tagged.handle);
+        return;
+    }
+
+    auto &channel = zmqContext.taskChannels_[i->second.task_];
+    const auto last = MDP::Client::Signature::last == tagged.handle->get(6);
+
+    /* out of order (or repeated) chunk, or client exceeded chunk window -
+     * task abandons request (replies FAILURE) */
+    if (std::to_string(i->second.next_) != tagged.handle->get(5)
+        || !last && MDP::Client::Signature::more != tagged.handle->get(6)
+        || !channel.tryPushRequest(tagged.handle))
+    {
+        TRACE(
+            TraceLevel::Warning, this, " chunk ", tagged.handle->get(5),
+            " rejected (next ", i->second.next_, "), request abandoned");
+        chunkedTasks_.erase(i);
+        channel.cancel();
+        return;
+    }
+
+    ++i->second.next_;
+    if (last) chunkedTasks_.erase(i);
 }
 
 void Worker::dispatch(
     ZMQContext &zmqContext, Tagged<Tag::ClientResponse> tagged)
 {
     ASSERT(tagged.handle);
-    TRACE(TraceLevel::Debug, this, ' ', tagged.handle);
-    send(zmqContext.socket_, std::move(*tagged.handle), IOMode::Blocking);
+    FAST_TRACE(Debug, "client rep", tagged.handle);
+    sendToBroker(zmqContext, std::move(*tagged.handle));
 }
 
 void Worker::dispatch(ZMQContext &, Tagged<Tag::BrokerHeartbeat> tagged)
 {
     ASSERT(tagged.handle);
-    TRACE(TraceLevel::Trace, this, ' ', monitor_);
-    monitor_.peerHeartbeat();
+    FAST_TRACE(Trace, "broker heartbeat", tagged.handle);
+
+    /* Frames 3+: effective heartbeat set by broker (after READY) */
+    if (3 >= tagged.handle->parts()) return;
+
+    using namespace MDP::Worker;
+
+    const auto period   = property(*tagged.handle, Property::heartbeat, 3);
+    const auto liveness = property(*tagged.handle, Property::liveness, 3);
+
+    if (period.empty() || liveness.empty()) return;
+
+    const auto periodMs = parseNumber(period);
+    const auto n        = parseNumber(liveness);
+
+    if (!periodMs || !n || 0 == *periodMs || 0 == *n)
+    {
+        TRACE(TraceLevel::Warning, this, " invalid heartbeat ", tagged.handle);
+        return;
+    }
+
+    monitor_.configure(std::chrono::milliseconds{*periodMs}, *n);
+    TRACE(
+        TraceLevel::Info, this, " heartbeat ", monitor_.period().count(),
+        "ms x", monitor_.liveness());
 }
 
 void Worker::dispatch(ZMQContext &, Tagged<Tag::BrokerDisconnect> tagged)
@@ -196,6 +563,40 @@ void Worker::dispatch(ZMQContext &, Tagged<Tag::BrokerDisconnect> tagged)
     ENSURE(false && " disconnected by broker", BrokerDisconnected);
 }
 
+void Worker::dispatch(ZMQContext &zmqContext, Tagged<Tag::BrokerCancel> tagged)
+{
+    ASSERT(tagged.handle);
+    FAST_TRACE(Debug, "broker cancel", tagged.handle);
+
+    /* Frame 3: client address (key) */
+    if (4 > tagged.handle->parts()) return;
+
+    const auto key = tagged.handle->get(3);
+    /* pending request: empty, "MDPW01", 0x02, client address, ... */
+    const auto i = std::find_if(
+        std::begin(pendingRequests_), std::end(pendingRequests_),
+        [&key](const MessageHandle &handle) { return key == handle->get(3); });
+
+    if (std::end(pendingRequests_) == i)
+    {
+        const auto task
+            = std::find(std::begin(taskKeys_), std::end(taskKeys_), key);
+
+        /* request being processed - streaming stops (rest of parts is
+         * dropped), its reply is discarded by broker */
+        if (std::end(taskKeys_) != task)
+        {
+            zmqContext.taskChannels_[task - std::begin(taskKeys_)].cancel();
+        }
+        /* request already processed - reply is discarded by broker */
+        return;
+    }
+
+    pendingRequests_.erase(i);
+    /* broker releases credit on reply, body is discarded */
+    sendToBroker(zmqContext, MDP::Worker::makeRep(ZMQIdentity{key}));
+}
+
 void Worker::dispatch(ZMQContext &, Tagged<Tag::Unsupported> tagged)
 {
     ASSERT(tagged.handle);
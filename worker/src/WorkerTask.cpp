@@ -2,68 +2,253 @@
 #include "ensure/Ensure.h"
 #include "mdp/Except.h"
 #include "mdp/MDP.h"
-#include "mdp/utils.h"
+
+#include <thread>
+
+namespace {
+
+/* append frame of src to dst without copying its data (src frame is left
+ * empty) */
+void moveFrame(zmqpp::message &dst, zmqpp::message &src, size_t part)
+{
+    const auto status = zmq_msg_move(&dst.raw_new_msg(), &src.raw_msg(part));
+
+    ENSURE(0 == status, RuntimeError);
+}
+
+/* streamed reply can have any number of parts (chunked request any number
+ * of ACCEPTs) - wait until worker drains replies instead of overflowing
+ * ring, false if request was cancelled (part is dropped) */
+bool pushStreamed(TaskChannel &channel, zmqpp::message message)
+{
+    if (channel.cancelled_) return false;
+
+    auto handle = MDP::makeMessageHandle(std::move(message));
+
+    while (!channel.tryPushReply(handle))
+    {
+        /* cancel wakes task waiting for space */
+        if (channel.cancelled_) return false;
+        channel.waitReplySpace();
+    }
+    return true;
+}
+
+/* last reply returns worker credit - never dropped, false if worker
+ * exits instead */
+bool pushLast(TaskChannel &channel, MDP::MessageHandle &handle)
+{
+    while (!channel.tryPushReply(handle))
+    {
+        /* exit wakes task waiting for space */
+        if (channel.exiting_) return false;
+        channel.waitReplySpace();
+    }
+    return true;
+}
+
+} /* namespace */
 
 WorkerTask::MasterGuard::~MasterGuard()
 {
     TRACE(TraceLevel::Debug, this);
-    send(socket_, zmqpp::message{"exit"}, IOMode::Blocking);
+
+    for (auto &channel : channels_) channel.exit();
 }
 
 WorkerTask::SlaveGuard::~SlaveGuard()
 {
     TRACE(TraceLevel::Debug, this);
-    send(socket_, zmqpp::message{"exited"}, IOMode::Blocking);
+
+    MDP::MessageHandle exited;
+
+    /* worker which sent exit no longer reads replies (ring may be full) */
+    channel_.tryPushReply(exited);
 }
 
-void WorkerTask::operator()(zmqpp::socket &socket)
+WorkerTask::ChunkReader::ChunkReader(
+    std::string clientAddress,
+    zmqpp::message &chunk,
+    const Sink &sink,
+    const Fetch &fetch)
+    : sink_{sink}
+    , fetch_{fetch}
+    , clientAddress_{std::move(clientAddress)}
 {
-    SlaveGuard guard{socket};
+    /* plain REQUEST (client did not chunk it) - single, last chunk
+     * Frames: empty, "MDPW01", 0x02, client address, empty, body */
+    if (MDP::Worker::Signature::chunk != chunk.get(2))
+    {
+        last_ = true;
+        MDP::popFront(chunk, 5);
+        next_ = std::move(chunk);
+        return;
+    }
+    /* Frames: empty, "MDPW01", 0x08, client address, empty, chunk number,
+     * flag */
+    ENSURE(7 <= chunk.parts(), MessageFormatInvalid);
 
-    for (;;)
+    last_ = MDP::Client::Signature::last == chunk.get(6);
+    MDP::popFront(chunk, 7);
+    next_ = std::move(chunk);
+}
+
+bool WorkerTask::ChunkReader::read(zmqpp::message &body)
+{
+    if (!pending_)
     {
-        zmqpp::message request;
+        if (last_) return false;
 
+        auto handle = fetch_();
+
+        if (!handle)
         {
-            const auto status = socket.receive(request, false /* dont_block */);
+            TRACE(TraceLevel::Warning, this, " chunked request abandoned");
+            abandoned_ = true;
+            return false;
+        }
 
-            ENSURE(status, RecvFailed);
+        ENSURE(7 <= handle->parts(), MessageFormatInvalid);
+        ENSURE(
+            MDP::Worker::Signature::chunk == handle->get(2),
+            MessageFormatInvalid);
 
-            if (1 == request.parts() && "exit" == request.get(0)) return;
+        last_ = MDP::Client::Signature::last == handle->get(6);
+        MDP::popFront(*handle, 7);
+        next_    = std::move(*handle);
+        pending_ = true;
+    }
+
+    /* last chunk is answered by reply */
+    if (!last_
+        && !sink_(MDP::Worker::makeAccept(ZMQIdentity{clientAddress_})))
+    {
+        TRACE(TraceLevel::Warning, this, " chunked request cancelled");
+        abandoned_ = true;
+        return false;
+    }
+
+    body     = std::move(next_);
+    pending_ = false;
+    return true;
+}
+
+void WorkerTask::operator()(TaskChannel &channel)
+{
+    SlaveGuard guard{channel};
+    /* next chunk of chunked request (exit, cancel or timeout - nullptr) */
+    const Fetch fetch = [this, &channel]() {
+        MDP::MessageHandle handle;
+
+        while (!channel.requests_.pop(handle))
+        {
+            /* exit cancels too */
+            if (channel.cancelled_) return handle;
+            if (!channel.requestEvent_.wait(chunkTimeout_)) return handle;
         }
+        return handle;
+    };
+
+    for (;;)
+    {
+        channel.requestEvent_.wait();
 
-        ASSERT(5 <= request.parts());
-
-        const auto clientAddress = request.get(3);
-
-        /* Frame 0: empty */
-        request.pop_front();
-        /* Frame 1: six byte signature (worker) */
-        request.pop_front();
-        /* Frame 2: one byte signature (worker request) */
-        request.pop_front();
-        /* Frame 3: Client address (envelope stack) */
-        request.pop_front();
-        /* Frame 4: Empty (zero bytes, envelope delimiter) */
-        request.pop_front();
-
-        auto reply = transform_(std::move(request));
-
-        /* Frame 4: Empty (zero bytes, envelope delimiter) */
-        reply.push_front(nullptr, 0);
-        /* Frame 3: Client address (envelope stack) */
-        reply.push_front(clientAddress);
-        /* Frame 2: one byte signature (worker request) */
-        reply.push_front(MDP::Worker::Signature::reply);
-        /* Frame 1: six byte signature (worker) */
-        reply.push_front(MDP::Worker::Signature::self);
-        /* Frame 0: empty */
-        reply.push_front(nullptr, 0);
+        MDP::MessageHandle handle;
 
+        while (!channel.exiting_ && channel.requests_.pop(handle))
         {
-            const auto status = socket.send(reply, false /* dont block */);
+            /* chunk of request already replied (transform returned before
+             * last chunk, or request abandoned) */
+            if (MDP::Worker::Signature::chunk == handle->get(2)
+                && "0" != handle->get(5))
+            {
+                continue;
+            }
 
-            ENSURE(status, SendFailed);
+            /* reply reuses request handle (no allocation) */
+            *handle = process(
+                *handle,
+                [&channel](zmqpp::message m) {
+                    return pushStreamed(channel, std::move(m));
+                },
+                fetch);
+            /* exit received while fetching chunks (or pushing reply) */
+            if (channel.exiting_ || !pushLast(channel, handle)) return;
         }
+        if (channel.exiting_) return;
+    }
+}
+
+zmqpp::message WorkerTask::process(
+    zmqpp::message &request, const Sink &sink, const Fetch &fetch)
+{
+    ASSERT(5 <= request.parts());
+
+    zmqpp::message reply;
+    /* every PARTIAL (ACCEPT) carries client address, REPLY takes the
+     * frame */
+    auto clientAddress = streamTransform_ || chunkedTransform_
+                           ? request.get(3)
+                           : std::string{};
+
+    /* Frame 0: empty */
+    reply.raw_new_msg();
+    /* Frame 1: six byte signature (worker) */
+    reply.add(MDP::Worker::Signature::self);
+    /* Frame 2: one byte signature (worker reply) */
+    reply.add(MDP::Worker::Signature::reply);
+    /* Frame 3: Client address (envelope stack) */
+    moveFrame(reply, request, 3);
+    /* Frame 4: Empty (zero bytes, envelope delimiter) */
+    reply.raw_new_msg();
+
+    if (viewTransform_)
+    {
+        /* Frames 5+: request body */
+        viewTransform_(FrameView{request, 5}, reply);
+    }
+    else if (chunkedTransform_)
+    {
+        ASSERT(fetch);
+
+        ChunkReader reader{clientAddress, request, sink, fetch};
+        auto body = chunkedTransform_(reader);
+
+        /* reply to incomplete request would pass for success */
+        if (reader.abandoned())
+            return MDP::Worker::makeFailure(ZMQIdentity{clientAddress});
+
+        for (size_t i = 0; i < body.parts(); ++i) moveFrame(reply, body, i);
+    }
+    else if (streamTransform_)
+    {
+        MDP::popFront(request, 5);
+
+        const Emit emit = [&sink, &clientAddress](zmqpp::message body) {
+            zmqpp::message partial;
+
+            partial.raw_new_msg();
+            partial.add(MDP::Worker::Signature::self);
+            partial.add(MDP::Worker::Signature::partial);
+            partial.add(clientAddress);
+            partial.raw_new_msg();
+
+            for (size_t i = 0; i < body.parts(); ++i)
+                moveFrame(partial, body, i);
+            return sink(std::move(partial));
+        };
+
+        auto body = streamTransform_(std::move(request), emit);
+
+        for (size_t i = 0; i < body.parts(); ++i) moveFrame(reply, body, i);
+    }
+    else
+    {
+        MDP::popFront(request, 5);
+
+        auto body = transform_(std::move(request));
+
+        for (size_t i = 0; i < body.parts(); ++i) moveFrame(reply, body, i);
     }
+    return reply;
 }
@@ -2,10 +2,9 @@
 #include "ensure/Ensure.h"
 #include "mdp/Except.h"
 
-ZMQWorkerContext::ZMQWorkerContext(ZMQIdentity identity, std::string address)
+ZMQWorkerContext::ZMQWorkerContext(
+    ZMQIdentity identity, std::string address, size_t concurrency)
     : socket_{context_, zmqpp::socket_type::dealer}
-    , masterSocket_{context_, zmqpp::socket_type::dealer}
-    , slaveSocket_{context_, zmqpp::socket_type::dealer}
     , identity_{std::move(identity)}
     , address_{std::move(address)}
 {
@@ -15,24 +14,14 @@ ZMQWorkerContext::ZMQWorkerContext(ZMQIdentity identity, std::string address)
     socket_.set(
         zmqpp::socket_option::identity, identity_.data(), identity_.size());
     socket_.set(zmqpp::socket_option::linger, 0);
+    socket_.connect(address_);
+    poller_.add(socket_, zmqpp::poller::poll_in | zmqpp::poller::poll_error);
 
-    const char slaveIdentity[]  = "slave";
-    const char masterIdentity[] = "master";
-    const char masterAddress[]  = "inproc://master";
-
-    masterSocket_.set(
-        zmqpp::socket_option::identity, masterIdentity, sizeof(masterIdentity));
-    masterSocket_.set(zmqpp::socket_option::linger, 0);
-
-    slaveSocket_.set(
-        zmqpp::socket_option::identity, slaveIdentity, sizeof(slaveIdentity));
-    slaveSocket_.set(zmqpp::socket_option::linger, 0);
+    /* inline worker */
+    if (0 == concurrency) return;
 
-    masterSocket_.bind(masterAddress);
-    slaveSocket_.connect(masterAddress);
+    for (size_t no = 0; no < concurrency; ++no)
+        taskChannels_.emplace_back(replyEvent_);
 
-    socket_.connect(address_);
-    poller_.add(socket_, zmqpp::poller::poll_in | zmqpp::poller::poll_error);
-    poller_.add(
-        masterSocket_, zmqpp::poller::poll_in | zmqpp::poller::poll_error);
+    poller_.add(replyEvent_.fd(), zmqpp::poller::poll_in);
 }